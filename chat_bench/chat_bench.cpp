@@ -0,0 +1,333 @@
+﻿
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <cstdlib>
+#include <memory_resource>
+
+#include "../win_chat_server/network.h"
+#include "../win_chat_server/poolThread.h"
+#include "../win_chat_server/msg.h"
+#include "../win_chat_server/frameScanner.h"
+#include "../win_chat_server/memPool.h"
+#include "../win_chat_server/slotMap.h"
+#include "../win_chat_server/room.h"
+
+#define BENCH_IP "127.0.0.1"
+#define BENCH_PORT 27115 // первый порт петли для замера Recive
+#define BENCH_PORT_TRY 16 // сколько портов подряд пробуем (прошлый запуск мог оставить порт в TIME_WAIT)
+#define BENCH_REPEAT 5 // количество прогонов каждого замера, в зачет идет лучший
+#define BENCH_TOLERANCE 20 // допустимое ухудшение относительно базовой линии по умолчанию, %
+#define FRAME_PAYLOAD 48 // полезная нагрузка кадра в замере Recive, байт
+#define LARGE_PAYLOAD (1 << 20) // полезная нагрузка большого кадра (вставленный текст), байт
+#define SCAN_BUFFER (64 * 1024) // размер буфера в замере поиска разделителей, байт
+#define REGISTRY_SIZE 1000 // собеседников в замере обхода реестра
+
+/// <summary>
+/// один микробенчмарк: фиксированное количество итераций и функция прогона
+/// </summary>
+struct bench_t
+{
+    std::string name; // имя замера (ключ в базовой линии)
+    unsigned long long iterations; // итераций в одном прогоне
+    std::function<void(unsigned long long)> run; // прогон заданного количества итераций
+};
+
+volatile unsigned long long sink = 0; // приемник результатов, чтобы компилятор не выбросил замеряемый код
+
+/// <summary>
+/// задача пула для замера круга AddTask -> Work: выставляет флаг выполнения
+/// </summary>
+class pingTask_t : public ABStask
+{
+public:
+    pingTask_t(std::atomic_bool& done) : done(done)
+    {}
+
+    void Work(const volatile std::atomic_bool& /*stop*/) override
+    {
+        done.store(true, std::memory_order_release);
+    }
+protected:
+    std::atomic_bool& done; // флаг выполнения задачи
+};
+
+/// <summary>
+/// метод прогона замера: BENCH_REPEAT раз по iterations итераций, результат - лучший прогон
+/// </summary>
+/// <param name="bench"> -- замер </param>
+/// <returns> наносекунд на итерацию </returns>
+double measure(const bench_t& bench)
+{
+    bench.run(bench.iterations / 10 + 1); // прогрев кэшей и аллокатора
+
+    double best = 0;
+    for (unsigned repeat = 0; repeat < BENCH_REPEAT; ++repeat)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bench.run(bench.iterations);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / bench.iterations;
+        if (repeat == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+/// <summary>
+/// функция чтения базовой линии: строки "имя нс_на_итерацию"
+/// </summary>
+/// <param name="nameFile"> - имя файла </param>
+/// <param name="m_base"> - ссылка на результат </param>
+/// <returns> 1 - файл прочитан </returns>
+bool readBaseline(const std::string& nameFile, std::map<std::string, double>& m_base)
+{
+    std::ifstream file(nameFile.c_str());
+    std::string name;
+    double value = 0;
+    while (file >> name >> value)
+        m_base[name] = value;
+    return !m_base.empty();
+}
+
+int main(int argc, char* argv[])
+{
+    std::map<std::string, double> m_base; // базовая линия
+    double tolerance = BENCH_TOLERANCE;
+    if (argc >= 2 && !readBaseline(argv[1], m_base))
+    {
+        printf("Invalid parametr's. Please enter the [baseline_file [tolerance_percent]]\n");
+        return EXIT_FAILURE;
+    }
+    if (argc >= 3)
+        tolerance = std::strtod(argv[2], NULL);
+
+    log_t logger("chat_bench.log", false); // замер логгера и ошибки сокетов идут в файл, консоль занята результатами
+    std::vector<bench_t> v_bench;
+
+    // msg_t
+    const std::string text(32, 'x');
+    v_bench.push_back({ "msg.construct", 1000000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            msg_t msg(TypeMsg::normal, text);
+            sink += msg.Str().size();
+        }
+    } });
+
+    const msg_t a_msg[] = { msg_t(TypeMsg::normal, text), msg_t(TypeMsg::Exit), msg_t(TypeMsg::shutDown), msg_t(TypeMsg::linkOn), msg_t(TypeMsg::printinfo), msg_t() };
+    const size_t countMsg = sizeof(a_msg) / sizeof(a_msg[0]);
+    // служебное сообщение с текстом: как у сессии, кадр в арене со сбросом после каждого сообщения
+    v_bench.push_back({ "msg.notice_arena", 1000000, [&](unsigned long long count) {
+        char buf[1024];
+        std::pmr::monotonic_buffer_resource arena(buf, sizeof(buf));
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            std::pmr::string frame(&arena);
+            frameMsg(frame, TypeMsg::normal, "SYSTEM MSG: error send message visavi, errno: 104");
+            sink += frame.size();
+            arena.release();
+        }
+    } });
+
+    v_bench.push_back({ "msg.decode", 10000000, [&](unsigned long long count) {
+        msg_t a_rx[countMsg]; // буферы приема, как у сессии
+        for (size_t i = 0; i < countMsg; ++i)
+            a_rx[i].Update() = a_msg[i].Str();
+        for (unsigned long long i = 0; i < count; ++i)
+            sink += a_rx[i % countMsg].Decode();
+    } });
+
+    v_bench.push_back({ "msg.type", 10000000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+            sink += a_msg[i % countMsg].Type();
+    } });
+
+    v_bench.push_back({ "msg.payload", 10000000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+            sink += a_msg[i % countMsg].Payload().size();
+    } });
+
+    // log_t
+    v_bench.push_back({ "log.get_time", 200000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+            sink += logger.getTime().size();
+    } });
+
+    v_bench.push_back({ "log.do_log", 100000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+            logger.doLog("bench record");
+    } });
+
+    // пул памяти против кучи: выделение и освобождение блока размера кадра
+    memPool_t memPool;
+    v_bench.push_back({ "mem.pool_alloc_free", 10000000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            void* ptr = memPool.Allocate(FRAME_PAYLOAD + 11);
+            sink += reinterpret_cast<size_t>(ptr);
+            memPool.Free(ptr, FRAME_PAYLOAD + 11);
+        }
+    } });
+    v_bench.push_back({ "mem.heap_alloc_free", 10000000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            void* ptr = ::operator new(FRAME_PAYLOAD + 11);
+            sink += reinterpret_cast<size_t>(ptr);
+            ::operator delete(ptr);
+        }
+    } });
+
+    // обход собеседников при рассылке: реестр slot map против списка weak_ptr с lock()
+    std::vector<std::shared_ptr<unsigned long long>> v_member;
+    slotMap_t<unsigned long long*> registry;
+    std::list<std::weak_ptr<unsigned long long>> l_member;
+    for (unsigned i = 0; i < REGISTRY_SIZE; ++i)
+    {
+        v_member.push_back(std::make_shared<unsigned long long>(i));
+        registry.Insert(v_member.back().get());
+        l_member.push_back(v_member.back());
+    }
+    v_bench.push_back({ "registry.slotmap_1k", 100000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+            for (unsigned long long* member : registry)
+                sink += *member;
+    } });
+    v_bench.push_back({ "registry.weak_list_1k", 20000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+            for (auto& it : l_member)
+                if (auto member = it.lock())
+                    sink += *member;
+    } });
+
+    // путь чтения рассылки в комнате: снимок состава (RCU) против мьютекса комнаты, 8 участников
+    room_t<unsigned long long> room("bench");
+    for (unsigned i = 0; i < 8; ++i)
+        room.members.Insert(v_member[i]);
+    room.Publish();
+    v_bench.push_back({ "room.snapshot_read_8", 1000000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            auto members = room.Snapshot();
+            for (const auto& member : *members)
+                sink += *member;
+        }
+    } });
+    v_bench.push_back({ "room.mutex_read_8", 1000000, [&](unsigned long long count) {
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            std::lock_guard<std::mutex> lock(room.mutex);
+            for (const auto& member : room.members)
+                sink += *member;
+        }
+    } });
+
+    // поиск разделителей в буфере из кадров: лучшая реализация и скалярная
+    std::string scanBuf;
+    while (scanBuf.size() < SCAN_BUFFER)
+        scanBuf += msg_t(TypeMsg::normal, std::string(FRAME_PAYLOAD, 'x')).Str();
+    std::cerr << "frame scanner: " << frameScanner_t::Name() << '\n';
+    v_bench.push_back({ "scan.best_64k", 20000, [&](unsigned long long count) {
+        frameEnds_t q_end;
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            q_end.clear();
+            sink += frameScanner_t::Scan(scanBuf.data(), scanBuf.size(), 0, "[EOM]", q_end);
+        }
+    } });
+    v_bench.push_back({ "scan.scalar_64k", 20000, [&](unsigned long long count) {
+        frameEnds_t q_end;
+        frameScanner_t::ForceScalar(true);
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            q_end.clear();
+            sink += frameScanner_t::Scan(scanBuf.data(), scanBuf.size(), 0, "[EOM]", q_end);
+        }
+        frameScanner_t::ForceScalar(false);
+    } });
+
+    // Recive: кадры идут потоком по петле, читатель разбирает их по EOM
+    std::unique_ptr<network::TCP_socketServer_t> acceptor;
+    std::unique_ptr<network::TCP_socketClient_t> writer;
+    network::TCP_socketClient_t reader(logger);
+    for (unsigned short port = BENCH_PORT; port < BENCH_PORT + BENCH_PORT_TRY; ++port)
+    {
+        acceptor.reset(new network::TCP_socketServer_t(BENCH_IP, port, logger));
+        writer.reset(new network::TCP_socketClient_t(BENCH_IP, port, logger));
+        if (writer->GetConnected() && writer->GetRemoteInfo().GetPort() == port) // подключились именно к своему ацептору
+            break;
+        writer.reset();
+    }
+    if (writer && 0 == acceptor->AddClient(reader))
+    {
+        const std::string frame = msg_t(TypeMsg::normal, std::string(FRAME_PAYLOAD, 'x')).Str();
+        v_bench.push_back({ "recv.eom_frame", 200000, [&, frame](unsigned long long count) {
+
+            std::thread thread([&]() {
+                std::string chunk;
+                for (unsigned i = 0; i < 64; ++i)
+                    chunk += frame;
+                for (unsigned long long sent = 0; sent < count; sent += 64)
+                    writer->Send(count - sent >= 64 ? chunk : chunk.substr(0, (count - sent) * frame.size()));
+            });
+            const unsigned long long total = count * frame.size(); // ждем ровно столько байт
+            unsigned long long received = 0;
+            std::string buf;
+            while (received < total && reader.Recive(buf, "[EOM]") >= 0)
+                received += buf.size();
+            thread.join();
+            sink += received;
+        } });
+
+        const std::string large = msg_t(TypeMsg::normal, std::string(LARGE_PAYLOAD, 'x')).Str();
+        v_bench.push_back({ "recv.large_frame", 20, [&, large](unsigned long long count) {
+            std::thread thread([&]() {
+                for (unsigned long long sent = 0; sent < count; ++sent)
+                    writer->Send(large);
+            });
+            std::string buf;
+            for (unsigned long long i = 0; i < count && reader.Recive(buf, "[EOM]") == 0; ++i)
+                sink += buf.size();
+            thread.join();
+        } });
+
+    }
+    else
+        std::cerr << "recv.eom_frame skipped: no free loopback port from " << BENCH_PORT << '\n';
+
+    // пул потоков: круг AddTask -> Work -> готово
+    poolThread_manager_t pool(2);
+    v_bench.push_back({ "pool.add_task_roundtrip", 500, [&](unsigned long long count) {
+        std::atomic_bool done(false);
+        auto task = std::make_shared<pingTask_t>(done);
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            done.store(false, std::memory_order_relaxed);
+            pool.AddTask(task);
+            while (!done.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+    } });
+
+    // прогон и сверка с базовой линией
+    int result = EXIT_SUCCESS;
+    for (auto& bench : v_bench)
+    {
+        double ns = measure(bench);
+        std::cout << bench.name << ' ' << ns << '\n';
+
+        auto it = m_base.find(bench.name);
+        if (it != m_base.end() && ns > it->second * (1 + tolerance / 100))
+        {
+            std::cerr << "REGRESSION " << bench.name << ": " << ns << " ns/op, baseline " << it->second << " ns/op, tolerance " << tolerance << "%\n";
+            result = EXIT_FAILURE;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,331 @@
+﻿
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <cstdlib>
+
+#include "../win_chat_server/network.h"
+#include "../win_chat_server/metrics.h"
+
+#define HEADER_LOAD "[NORM]LOAD " // заголовок нагрузочного сообщения, за ним время отправки в мкс
+#define EOM "[EOM]" // конец сообщения
+#define HEADER_PING "[PING]" // проверка связи от сервера, отвечаем [PONG]
+#define MSG_PONG "[PONG][EOM]" // ответ на проверку связи
+#define WARMUP_MS 500 // ожидание после подключения, пока сервер раздаст рукопожатия
+#define DRAIN_MS 1000 // ожидание доставки последних сообщений после окончания отправки
+#define SEND_BURST 64 // максимум отправок за одну итерацию цикла, чтобы не голодал прием
+
+/// <summary>
+/// параметры нагрузочного теста
+/// </summary>
+struct param_t
+{
+    std::string ip; // адрес сервера
+    unsigned short port; // порт сервера
+    unsigned connections; // количество соединений
+    unsigned rate; // суммарная частота отправки, сообщений в секунду
+    unsigned duration; // длительность отправки, секунд
+    unsigned payload; // размер полезной нагрузки сообщения, байт
+    std::string reportFile; // файл отчета (пусто - только в консоль)
+};
+
+/// <summary>
+/// одно клиентское соединение нагрузочного теста
+/// </summary>
+struct connection_t
+{
+    std::shared_ptr<network::TCP_socketClient_t> socket; // сокет соединения
+    std::string rx; // принятые, но еще не разобранные данные
+    std::string tx; // сообщение, которое отправляется в данный момент
+    unsigned txOffset; // сколько байт сообщения tx уже отправлено
+    bool b_open; // соединение живо
+};
+
+/// <summary>
+/// Класс генератора нагрузки: N соединений отправляют [NORM] сообщения с отметкой времени,
+/// по принятым рассылкам считаем задержку доставки и пропускную способность
+/// </summary>
+class load_t
+{
+public:
+    /// <summary>
+    /// конструктор
+    /// </summary>
+    /// <param name="param"> -- параметры теста </param>
+    /// <param name="logger"> -- ссылка на обект логгирования </param>
+    load_t(const param_t& param, log_t& logger) : param(param), logger(logger), mux(param.connections, logger),
+        sent(0), sentBytes(0), delivered(0), deliveredBytes(0), open(0), closed(0), next(0)
+    {}
+
+    /// <summary>
+    /// метод подключения всех соединений
+    /// </summary>
+    /// <returns> количество установленных соединений </returns>
+    unsigned Connect()
+    {
+        unsigned result = 0;
+        v_conn.resize(param.connections);
+        for (auto& conn : v_conn)
+        {
+            conn.socket = std::make_shared<network::TCP_socketClient_t>(param.ip, param.port, logger);
+            conn.txOffset = 0;
+            conn.b_open = conn.socket->GetConnected() && mux.AddReader(conn.socket);
+            if (conn.b_open)
+                ++result;
+        }
+        open = result;
+        return result;
+    }
+
+    /// <summary>
+    /// основной метод работы: прогрев, отправка с заданной частотой, дослушивание
+    /// </summary>
+    void Work()
+    {
+        unsigned long long now = metrics_t::Now();
+        unsigned long long warmupEnd = now + WARMUP_MS * 1000ULL;
+        while ((now = metrics_t::Now()) < warmupEnd) // отдаем серверу время раздать рукопожатия
+            Poll();
+
+        start = metrics_t::Now();
+        unsigned long long sendEnd = start + param.duration * 1000000ULL;
+        unsigned long long drainEnd = sendEnd + DRAIN_MS * 1000ULL;
+        while ((now = metrics_t::Now()) < drainEnd)
+        {
+            if (now < sendEnd)
+            {
+                unsigned long long due = param.rate * (now - start) / 1000000; // сколько сообщений уже должно быть отправлено
+                for (unsigned burst = 0; sent < due && burst < SEND_BURST; ++burst)
+                    if (!sendNext(now))
+                        break;
+            }
+            else if (stop == 0)
+                stop = now;
+            Poll();
+        }
+    }
+
+    /// <summary>
+    /// метод формирования отчета в формате JSON
+    /// </summary>
+    /// <param name="buf"> -- буфер для вывода </param>
+    void Report(std::string& buf) const
+    {
+        double seconds = (stop - start) / 1000000.0;
+        if (seconds <= 0)
+            seconds = 1;
+
+        buf = "{\n";
+        buf += "  \"connections\": " + std::to_string(param.connections) + ",\n";
+        buf += "  \"connected_at_end\": " + std::to_string(open) + ",\n";
+        buf += "  \"closed_by_server\": " + std::to_string(closed) + ",\n";
+        buf += "  \"target_rate\": " + std::to_string(param.rate) + ",\n";
+        buf += "  \"payload_bytes\": " + std::to_string(param.payload) + ",\n";
+        buf += "  \"duration_s\": " + std::to_string(seconds) + ",\n";
+        buf += "  \"sent\": " + std::to_string(sent) + ",\n";
+        buf += "  \"delivered\": " + std::to_string(delivered) + ",\n";
+        buf += "  \"fanout\": " + std::to_string(sent ? static_cast<double>(delivered) / sent : 0.0) + ",\n";
+        buf += "  \"sent_msg_per_s\": " + std::to_string(sent / seconds) + ",\n";
+        buf += "  \"delivered_msg_per_s\": " + std::to_string(delivered / seconds) + ",\n";
+        buf += "  \"sent_bytes_per_s\": " + std::to_string(sentBytes / seconds) + ",\n";
+        buf += "  \"delivered_bytes_per_s\": " + std::to_string(deliveredBytes / seconds) + ",\n";
+        buf += "  \"latency_us\": { \"count\": " + std::to_string(latency.Count())
+            + ", \"mean\": " + std::to_string(latency.Mean())
+            + ", \"p50\": " + std::to_string(latency.Percentile(50))
+            + ", \"p90\": " + std::to_string(latency.Percentile(90))
+            + ", \"p99\": " + std::to_string(latency.Percentile(99))
+            + ", \"p999\": " + std::to_string(latency.Percentile(99.9))
+            + ", \"max\": " + std::to_string(latency.Max()) + " }\n";
+        buf += "}\n";
+    }
+protected:
+    /// <summary>
+    /// метод отправки очередного сообщения со следующего по кругу живого соединения
+    /// </summary>
+    /// <param name="now"> -- текущее время, мкс </param>
+    /// <returns> 1 - сообщение поставлено в отправку </returns>
+    bool sendNext(unsigned long long now)
+    {
+        for (size_t attempt = 0; attempt < v_conn.size(); ++attempt)
+        {
+            connection_t& conn = v_conn[next];
+            next = (next + 1) % v_conn.size();
+            if (!conn.b_open || !conn.tx.empty())
+                continue; // соединение закрыто или еще не дописало прошлое сообщение
+
+            conn.tx = HEADER_LOAD + std::to_string(now) + ' ' + std::string(param.payload, 'x') + EOM;
+            conn.txOffset = 0;
+            ++sent;
+            sentBytes += conn.tx.size();
+            flush(conn);
+            return true;
+        }
+        return false;
+    }
+
+    /// <summary>
+    /// метод дописывания сообщения в неблокирующий сокет
+    /// </summary>
+    /// <param name="conn"> -- соединение </param>
+    void flush(connection_t& conn)
+    {
+        int result = conn.socket->Send(conn.tx, conn.txOffset);
+        if (result == 0)
+            conn.tx.clear(); // отправили полностью
+        else if (result > 0)
+            conn.txOffset = result; // отправили часть, допишем на следующей итерации
+        else if (result != -3)
+            close(conn);
+    }
+
+    /// <summary>
+    /// метод одной итерации мультиплексора: дописываем начатые сообщения и разбираем принятые
+    /// </summary>
+    void Poll()
+    {
+        if (open == 0)
+        { // слушать нечего, сервер закрыл все соединения
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return;
+        }
+
+        for (auto& conn : v_conn)
+            if (conn.b_open && !conn.tx.empty())
+                flush(conn);
+
+        if (!mux.Work(1))
+            return;
+
+        for (auto& conn : v_conn)
+            if (conn.b_open && mux.GetReadyReader(conn.socket))
+            {
+                int result = conn.socket->Recive(conn.rx, EOM);
+                if (result == -1 || result == -2)
+                    close(conn);
+                parse(conn);
+            }
+    }
+
+    /// <summary>
+    /// метод разбора принятых данных на сообщения и учета задержки доставки
+    /// </summary>
+    /// <param name="conn"> -- соединение </param>
+    void parse(connection_t& conn)
+    {
+        unsigned long long now = metrics_t::Now();
+        size_t begin = 0, end = 0;
+        while ((end = conn.rx.find(EOM, begin)) != std::string::npos)
+        {
+            if (conn.rx.compare(begin, sizeof(HEADER_LOAD) - 1, HEADER_LOAD) == 0)
+            {
+                unsigned long long sendTime = std::strtoull(&conn.rx[begin + sizeof(HEADER_LOAD) - 1], NULL, 10);
+                if (sendTime >= start && sendTime <= now) // сообщения прогрева и мусор не учитываем
+                {
+                    latency.Record(now - sendTime);
+                    ++delivered;
+                    deliveredBytes += end + sizeof(EOM) - 1 - begin;
+                }
+            }
+            else if (conn.rx.compare(begin, sizeof(HEADER_PING) - 1, HEADER_PING) == 0)
+                conn.tx += MSG_PONG; // уйдет следом за недописанным сообщением, если оно есть
+            begin = end + sizeof(EOM) - 1;
+        }
+        conn.rx.erase(0, begin);
+    }
+
+    /// <summary>
+    /// метод закрытия соединения
+    /// </summary>
+    /// <param name="conn"> -- соединение </param>
+    void close(connection_t& conn)
+    {
+        if (conn.b_open)
+        {
+            conn.b_open = false;
+            conn.tx.clear();
+            mux.deleteReader(conn.socket);
+            --open;
+            ++closed;
+        }
+    }
+
+    const param_t& param; // параметры теста
+    log_t& logger; // ссылка на обект логгирования
+    network::NonBlockSocket_manager_t mux; // мультиплексор неблокирующих сокетов
+    std::vector<connection_t> v_conn; // соединения
+    histogram_t latency; // задержка доставки (отправка -> прием собеседником), мкс
+    unsigned long long sent; // отправлено сообщений
+    unsigned long long sentBytes; // отправлено байт
+    unsigned long long delivered; // принято рассылок
+    unsigned long long deliveredBytes; // принято байт в рассылках
+    unsigned open; // живых соединений
+    unsigned closed; // соединений закрыто сервером (в т.ч. по лимиту клиентов)
+
+    size_t next; // следующее соединение для отправки
+    unsigned long long start = 0; // начало отправки, мкс
+    unsigned long long stop = 0; // конец отправки, мкс
+};
+
+/// <summary>
+/// функция разобра параметров командной строки
+/// </summary>
+/// <param name="argc"> - количество параметров </param>
+/// <param name="argv"> - массив параметров </param>
+/// <param name="r_param"> - ссылка на параметры теста </param>
+/// <returns> 1 - праметры распознаны </returns>
+bool parseParam(int argc, char* argv[], param_t& r_param);
+
+int main(int argc, char* argv[])
+{
+    param_t param;
+
+    if (parseParam(argc, argv, param))
+    {
+        log_t logger("chat_load_client.log", false); // ошибки сокетов только в файл, консоль занята отчетом
+        load_t load(param, logger);
+        unsigned connected = load.Connect();
+        std::cerr << "connected " << connected << " of " << param.connections << '\n';
+
+        load.Work();
+
+        std::string report;
+        load.Report(report);
+        std::cout << report;
+        if (!param.reportFile.empty())
+        {
+            std::ofstream file(param.reportFile.c_str(), std::ios::trunc);
+            file << report;
+        }
+    }
+    else
+        printf("Invalid parametr's. Please enter the ip port connections rate_msg_per_s duration_s [payload_bytes [report_file]]\n");
+
+    return EXIT_SUCCESS;
+}
+
+/// <summary>
+/// функция разобра параметров командной строки
+/// </summary>
+/// <param name="argc"> - количество параметров </param>
+/// <param name="argv"> - массив параметров </param>
+/// <param name="r_param"> - ссылка на параметры теста </param>
+/// <returns> 1 - праметры распознаны </returns>
+bool parseParam(int argc, char* argv[], param_t& r_param)
+{
+    if (argc < 6 || argc > 8)
+        return false;
+
+    r_param.ip = argv[1];
+    unsigned long port = std::strtoul(argv[2], NULL, 10);
+    r_param.connections = std::strtoul(argv[3], NULL, 10);
+    r_param.rate = std::strtoul(argv[4], NULL, 10);
+    r_param.duration = std::strtoul(argv[5], NULL, 10);
+    r_param.payload = argc >= 7 ? std::strtoul(argv[6], NULL, 10) : 32;
+    r_param.reportFile = argc == 8 ? argv[7] : "";
+    r_param.port = static_cast<unsigned short>(port);
+
+    return port != 0 && port <= 0xFFFF && r_param.connections != 0 && r_param.rate != 0 && r_param.duration != 0;
+}
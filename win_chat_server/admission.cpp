@@ -0,0 +1,157 @@
+﻿#include "admission.h"
+
+#include <cstring>
+
+namespace
+{
+    /// <summary>
+    /// значимые байты IP адреса клиента (без порта)
+    /// </summary>
+    size_t addressOf(const network::endpoint_t& peer, const unsigned char*& r_ip)
+    {
+        if (peer.GetFamily() == AF_INET6)
+        {
+            r_ip = reinterpret_cast<const unsigned char*>(&peer.addr.v6.sin6_addr);
+            return sizeof(peer.addr.v6.sin6_addr);
+        }
+        r_ip = reinterpret_cast<const unsigned char*>(&peer.addr.v4.sin_addr);
+        return sizeof(peer.addr.v4.sin_addr);
+    }
+}
+
+/// <summary>
+/// конструктор
+/// </summary>
+/// <param name="tableSize"> - слотов таблицы адресов (округляется вверх до степени двойки) </param>
+/// <param name="rate"> - общая частота подключений, в секунду </param>
+/// <param name="burst"> - общий запас подключений (емкость бакета) </param>
+/// <param name="rateIP"> - частота подключений с одного адреса, в секунду </param>
+/// <param name="burstIP"> - запас подключений одного адреса </param>
+/// <param name="maxIP"> - одновременных подключений с одного адреса </param>
+admission_t::admission_t(size_t tableSize, unsigned rate, unsigned burst, unsigned rateIP, unsigned burstIP, unsigned maxIP) :
+    rate(rate), burst(burst), rateIP(rateIP), burstIP(burstIP), maxIP(maxIP), tracked(0)
+{
+    global.Reset(burst, 0);
+    size_t size = ADMISSION_PROBE;
+    while (size < tableSize)
+        size <<= 1;
+    v_slot.assign(size, slot_t());
+}
+
+/// <summary>
+/// Метод поиска слота адреса в окне проб
+/// </summary>
+/// <param name="peer"> - адрес клиента </param>
+/// <param name="now"> - текущее время, мкс (для выбора свободного слота) </param>
+/// <param name="b_insert"> - занять свободный слот, если адреса нет </param>
+/// <returns> слот; nullptr - адреса нет (либо некуда вставить) </returns>
+admission_t::slot_t* admission_t::find(const network::endpoint_t& peer, unsigned long long now, bool b_insert)
+{
+    const unsigned char* ip = nullptr;
+    size_t size = addressOf(peer, ip);
+    unsigned short family = static_cast<unsigned short>(peer.GetFamily());
+
+    uint64_t hash = 14695981039346656037ull; // FNV-1a по байтам адреса
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ ip[i]) * 1099511628211ull;
+
+    size_t mask = v_slot.size() - 1;
+    slot_t* free = nullptr;
+    for (size_t probe = 0; probe < ADMISSION_PROBE; ++probe)
+    {   // адрес ищем во всем окне: занятый заново слот не обрывает цепочку
+        slot_t& slot = v_slot[(hash + probe) & mask];
+        if (slot.family == family && memcmp(slot.ip, ip, size) == 0)
+            return &slot;
+        // свободен ни разу не занятый слот либо адрес без подключений с полным бакетом: он ничего не помнит
+        if (free == nullptr && b_insert && (slot.family == 0 || (slot.active == 0 && slot.bucket.Refill(rateIP, burstIP, now) >= burstIP)))
+            free = &slot;
+    }
+
+    if (free != nullptr)
+    {
+        tracked += free->family == 0;
+        memset(free->ip, 0, sizeof(free->ip));
+        memcpy(free->ip, ip, size);
+        free->family = family;
+        free->active = 0;
+        free->bucket.Reset(burstIP, now);
+    }
+    return free;
+}
+
+/// <summary>
+/// Метод проверки подключения. Токены списываются только при допуске
+/// </summary>
+/// <param name="peer"> - адрес клиента (порт не учитывается) </param>
+/// <param name="now"> - текущее время, мкс </param>
+/// <returns> результат проверки; для admitted по закрытию подключения обязателен Release() </returns>
+AdmitResult admission_t::Admit(const network::endpoint_t& peer, unsigned long long now)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (rate != 0 && global.Refill(rate, burst, now) < 1.0)
+        return rejectRate;
+
+    if (rateIP != 0 || maxIP != 0)
+    {
+        slot_t* slot = find(peer, now, true);
+        if (slot == nullptr)
+            return rejectTableFull;
+        if (maxIP != 0 && slot->active >= maxIP)
+            return rejectConnIP;
+        if (rateIP != 0)
+        {
+            if (slot->bucket.Refill(rateIP, burstIP, now) < 1.0)
+                return rejectRateIP;
+            slot->bucket.tokens -= 1.0;
+        }
+        ++slot->active;
+    }
+
+    if (rate != 0)
+        global.tokens -= 1.0;
+    return admitted;
+}
+
+/// <summary>
+/// Метод учета закрытия допущенного подключения
+/// </summary>
+/// <param name="peer"> - адрес клиента </param>
+void admission_t::Release(const network::endpoint_t& peer)
+{
+    if (rateIP == 0 && maxIP == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    slot_t* slot = find(peer, 0, false);
+    if (slot != nullptr && slot->active > 0)
+        --slot->active;
+}
+
+/// <summary>
+/// Метод учета подключения, допущенного прошлым процессом (передача сокетов): лимиты не проверяются,
+/// токены не списываются. По закрытию подключения обязателен Release()
+/// </summary>
+/// <param name="peer"> - адрес клиента </param>
+/// <param name="now"> - текущее время, мкс </param>
+void admission_t::Track(const network::endpoint_t& peer, unsigned long long now)
+{
+    if (rateIP == 0 && maxIP == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    slot_t* slot = find(peer, now, true);
+    if (slot != nullptr) // места в окне проб нет - адрес останется без учета, Release() его не найдет
+        ++slot->active;
+}
+
+/// <summary>
+/// Метод вывода состояния в текстовом виде "admission.имя значение"
+/// </summary>
+/// <param name="buf"> - буфер для вывода </param>
+void admission_t::Print(std::string& buf)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    buf += "admission.table_slots " + std::to_string(v_slot.size())
+        + "\nadmission.tracked_ips " + std::to_string(tracked)
+        + "\nadmission.global_tokens " + std::to_string(static_cast<unsigned long long>(global.tokens)) + '\n';
+}
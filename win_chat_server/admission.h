@@ -0,0 +1,110 @@
+﻿#pragma once
+#ifndef ADMISSION_H_
+#define ADMISSION_H_
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+#include "network.h"
+#include "tokenBucket.h"
+
+#define ADMISSION_PROBE 8 // окно проб открытой адресации: адрес ищется только в этих слотах
+
+/// <summary>
+/// результат проверки допуска подключения
+/// </summary>
+enum AdmitResult
+{
+    admitted, // подключение допущено
+    rejectRate, // исчерпан общий бакет частоты подключений
+    rejectRateIP, // исчерпан бакет частоты подключений адреса
+    rejectConnIP, // у адреса максимум одновременных подключений
+    rejectTableFull, // в окне проб нет места под новый адрес
+    countAdmit // количество результатов
+};
+
+/// <summary>
+/// Допуск подключений сразу после accept: общий бакет токенов частоты подключений и бакеты по IP источника
+/// (частота и одновременные подключения). Адреса лежат в таблице открытой адресации фиксированного размера,
+/// выделенной при старте; слот адреса без подключений и с полным бакетом ничего не помнит и занимается заново.
+/// Нулевой параметр выключает свое ограничение. Потокобезопасен
+/// </summary>
+class admission_t
+{
+public:
+    /// <summary>
+    /// конструктор
+    /// </summary>
+    /// <param name="tableSize"> - слотов таблицы адресов (округляется вверх до степени двойки) </param>
+    /// <param name="rate"> - общая частота подключений, в секунду </param>
+    /// <param name="burst"> - общий запас подключений (емкость бакета) </param>
+    /// <param name="rateIP"> - частота подключений с одного адреса, в секунду </param>
+    /// <param name="burstIP"> - запас подключений одного адреса </param>
+    /// <param name="maxIP"> - одновременных подключений с одного адреса </param>
+    admission_t(size_t tableSize, unsigned rate, unsigned burst, unsigned rateIP, unsigned burstIP, unsigned maxIP);
+
+    admission_t(const admission_t&) = delete;
+    admission_t& operator=(const admission_t&) = delete;
+
+    /// <summary>
+    /// Метод проверки подключения. Токены списываются только при допуске
+    /// </summary>
+    /// <param name="peer"> - адрес клиента (порт не учитывается) </param>
+    /// <param name="now"> - текущее время, мкс </param>
+    /// <returns> результат проверки; для admitted по закрытию подключения обязателен Release() </returns>
+    AdmitResult Admit(const network::endpoint_t& peer, unsigned long long now);
+
+    /// <summary>
+    /// Метод учета закрытия допущенного подключения
+    /// </summary>
+    /// <param name="peer"> - адрес клиента </param>
+    void Release(const network::endpoint_t& peer);
+
+    /// <summary>
+    /// Метод учета подключения, допущенного прошлым процессом (передача сокетов): лимиты не проверяются,
+    /// токены не списываются. По закрытию подключения обязателен Release()
+    /// </summary>
+    /// <param name="peer"> - адрес клиента </param>
+    /// <param name="now"> - текущее время, мкс </param>
+    void Track(const network::endpoint_t& peer, unsigned long long now);
+
+    /// <summary>
+    /// Метод вывода состояния в текстовом виде "admission.имя значение"
+    /// </summary>
+    /// <param name="buf"> - буфер для вывода </param>
+    void Print(std::string& buf);
+protected:
+    /// <summary>
+    /// слот таблицы адресов
+    /// </summary>
+    struct slot_t
+    {
+        unsigned char ip[16]; // адрес IPv4 (4 байта) либо IPv6
+        unsigned short family; // семейство адресов (0 - слот ни разу не занят)
+        unsigned active; // одновременных подключений
+        tokenBucket_t bucket; // частота подключений адреса
+    };
+
+    /// <summary>
+    /// Метод поиска слота адреса в окне проб
+    /// </summary>
+    /// <param name="peer"> - адрес клиента </param>
+    /// <param name="now"> - текущее время, мкс (для выбора свободного слота) </param>
+    /// <param name="b_insert"> - занять свободный слот, если адреса нет </param>
+    /// <returns> слот; nullptr - адреса нет (либо некуда вставить) </returns>
+    slot_t* find(const network::endpoint_t& peer, unsigned long long now, bool b_insert);
+
+    const unsigned rate; // общая частота подключений, в секунду
+    const unsigned burst; // общий запас подключений
+    const unsigned rateIP; // частота подключений адреса, в секунду
+    const unsigned burstIP; // запас подключений адреса
+    const unsigned maxIP; // одновременных подключений адреса
+    std::mutex mutex; // защита бакетов и таблицы
+    tokenBucket_t global; // общий бакет
+    std::vector<slot_t> v_slot; // таблица адресов (размер - степень двойки)
+    size_t tracked; // занятых слотов
+};
+
+#endif /* ADMISSION_H_ */
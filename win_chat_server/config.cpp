@@ -0,0 +1,281 @@
+﻿#include "config.h"
+#include "network.h"
+#include "history.h"
+
+#include <fstream>
+#include <charconv>
+#include <cstring>
+
+namespace
+{
+    /// <summary>
+    /// разбор беззнакового числа в диапазоне [min, max], строка должна целиком быть числом
+    /// </summary>
+    template<class Number>
+    bool parseNumber(const std::string& value, Number min, Number max, Number& r_number)
+    {
+        unsigned long long number = 0;
+        const char* end = value.data() + value.size();
+        auto parsed = std::from_chars(value.data(), end, number);
+        if (parsed.ec != std::errc() || parsed.ptr != end || number < static_cast<unsigned long long>(min)
+            || number > static_cast<unsigned long long>(max))
+            return false;
+        r_number = static_cast<Number>(number);
+        return true;
+    }
+
+    /// <summary>
+    /// обрезка пробелов по краям
+    /// </summary>
+    std::string trim(const std::string& str)
+    {
+        size_t begin = str.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+            return std::string();
+        return str.substr(begin, str.find_last_not_of(" \t\r") - begin + 1);
+    }
+}
+
+/// <summary>
+/// конструктор: значения по умолчанию
+/// </summary>
+config_t::config_t() : listen(CONFIG_LISTEN), port(0), adminListen(CONFIG_LISTEN), adminPort(0), traceSample(0),
+    maxClients(CONFIG_MAX_CLIENTS), poolThreads(0), recvChunk(CONFIG_RECV_CHUNK), maxFrame(CONFIG_MAX_FRAME), sessionArena(CONFIG_SESSION_ARENA),
+    backlog(CONFIG_BACKLOG), acceptBatch(CONFIG_ACCEPT_BATCH), connRate(CONFIG_CONN_RATE), connBurst(CONFIG_CONN_RATE),
+    connRateIP(CONFIG_CONN_RATE_IP), connBurstIP(2 * CONFIG_CONN_RATE_IP), connMaxIP(0), admissionTable(CONFIG_ADMISSION_TABLE),
+    msgRate(CONFIG_MSG_RATE), msgBurst(2 * CONFIG_MSG_RATE), byteRate(CONFIG_BYTE_RATE), byteBurst(CONFIG_BYTE_RATE),
+    pingIntervalMs(CONFIG_PING_INTERVAL_MS), idleTimeoutMs(CONFIG_IDLE_TIMEOUT_MS), writeStallMs(CONFIG_WRITE_STALL_MS),
+    drainTimeoutMs(CONFIG_DRAIN_TIMEOUT_MS), takeover(false), historyFsync(CONFIG_HISTORY_FSYNC),
+    historyFsyncMs(CONFIG_HISTORY_FSYNC_MS), historyFsyncEvery(CONFIG_HISTORY_FSYNC_EVERY),
+    historySegmentMb(CONFIG_HISTORY_SEGMENT_MB), historyReplay(0), socketProfile(CONFIG_SOCKET_PROFILE)
+{}
+
+/// <summary>
+/// Метод установки одного параметра по имени (в командной строке '-' в имени равен '_')
+/// </summary>
+/// <param name="key"> - имя параметра </param>
+/// <param name="value"> - значение </param>
+/// <returns> 1 - параметр распознан и значение корректно; 0 - описание ошибки в error </returns>
+bool config_t::Set(std::string key, const std::string& value)
+{
+    for (char& c : key)
+        if (c == '-')
+            c = '_';
+
+    bool b_result = true;
+    if (key == "listen")
+        listen = value;
+    else if (key == "port")
+        b_result = parseNumber(value, 1u, 0xFFFFu, port);
+    else if (key == "admin_listen")
+        adminListen = value;
+    else if (key == "admin_port")
+        b_result = parseNumber(value, 0u, 0xFFFFu, adminPort);
+    else if (key == "trace_sample")
+        b_result = parseNumber(value, 0u, 0xFFFFFFFEu, traceSample);
+    else if (key == "max_clients")
+        b_result = parseNumber(value, size_t(1), size_t(1000000), maxClients);
+    else if (key == "pool_threads")
+        b_result = parseNumber(value, size_t(0), size_t(1000000), poolThreads);
+    else if (key == "recv_chunk")
+        b_result = parseNumber(value, size_t(512), size_t(1 << 20), recvChunk);
+    else if (key == "max_frame")
+        b_result = parseNumber(value, size_t(0), size_t(1 << 30), maxFrame);
+    else if (key == "session_arena")
+        b_result = parseNumber(value, size_t(64), size_t(1 << 16), sessionArena);
+    else if (key == "backlog")
+        b_result = parseNumber(value, 1, 1 << 20, backlog);
+    else if (key == "accept_batch")
+        b_result = parseNumber(value, size_t(1), size_t(65536), acceptBatch);
+    else if (key == "conn_rate")
+        b_result = parseNumber(value, 0u, 1000000u, connRate);
+    else if (key == "conn_burst")
+        b_result = parseNumber(value, 1u, 1000000u, connBurst);
+    else if (key == "conn_rate_ip")
+        b_result = parseNumber(value, 0u, 1000000u, connRateIP);
+    else if (key == "conn_burst_ip")
+        b_result = parseNumber(value, 1u, 1000000u, connBurstIP);
+    else if (key == "conn_max_ip")
+        b_result = parseNumber(value, 0u, 1000000u, connMaxIP);
+    else if (key == "admission_table")
+        b_result = parseNumber(value, size_t(8), size_t(1 << 24), admissionTable);
+    else if (key == "msg_rate")
+        b_result = parseNumber(value, 0u, 10000000u, msgRate);
+    else if (key == "msg_burst")
+        b_result = parseNumber(value, 1u, 10000000u, msgBurst);
+    else if (key == "byte_rate")
+        b_result = parseNumber(value, 0u, 0x7FFFFFFFu, byteRate);
+    else if (key == "byte_burst")
+        b_result = parseNumber(value, 1u, 0x7FFFFFFFu, byteBurst);
+    else if (key == "ping_interval_ms")
+        b_result = parseNumber(value, 0u, 86400000u, pingIntervalMs);
+    else if (key == "idle_timeout_ms")
+        b_result = parseNumber(value, 0u, 86400000u, idleTimeoutMs);
+    else if (key == "write_stall_ms")
+        b_result = parseNumber(value, 0u, 86400000u, writeStallMs);
+    else if (key == "drain_timeout_ms")
+        b_result = parseNumber(value, 0u, 600000u, drainTimeoutMs);
+    else if (key == "handoff_path")
+        handoffPath = value;
+    else if (key == "takeover")
+        b_result = parseNumber(value, false, true, takeover);
+    else if (key == "history_dir")
+        historyDir = value;
+    else if (key == "history_fsync")
+    {
+        history_t::policy_t policy;
+        b_result = history_t::FindPolicy(value, policy);
+        historyFsync = b_result ? value : historyFsync;
+    }
+    else if (key == "history_fsync_ms")
+        b_result = parseNumber(value, 1u, 3600000u, historyFsyncMs);
+    else if (key == "history_fsync_every")
+        b_result = parseNumber(value, 1u, 100000000u, historyFsyncEvery);
+    else if (key == "history_segment_mb")
+        b_result = parseNumber(value, 1u, 1u << 20, historySegmentMb);
+    else if (key == "history_replay")
+        b_result = parseNumber(value, 0u, 1000000u, historyReplay);
+    else if (key == "socket_profile")
+    {
+        b_result = network::sockProfile_t::Find(value) != nullptr;
+        socketProfile = b_result ? value : socketProfile;
+    }
+    else
+    {
+        error = "unknown parametr '" + key + "'";
+        return false;
+    }
+
+    if (!b_result)
+        error = "invalid value '" + value + "' for parametr '" + key + "'";
+    return b_result;
+}
+
+/// <summary>
+/// Метод чтения файла параметров: строки "ключ = значение", '#' - комментарий до конца строки
+/// </summary>
+/// <param name="fileName"> - имя файла </param>
+/// <returns> 1 - файл прочитан; 0 - описание ошибки в error </returns>
+bool config_t::LoadFile(const std::string& fileName)
+{
+    std::ifstream file(fileName.c_str());
+    if (!file.is_open())
+    {
+        error = "can't open config file '" + fileName + "'";
+        return false;
+    }
+
+    std::string line;
+    for (unsigned lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos || !Set(trim(line.substr(0, eq)), trim(line.substr(eq + 1))))
+        {
+            if (eq == std::string::npos)
+                error = "expected 'key = value'";
+            error = fileName + ':' + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// Метод разбора командной строки с итоговой проверкой параметров
+/// </summary>
+/// <param name="argc"> - количество параметров </param>
+/// <param name="argv"> - массив параметров </param>
+/// <returns> 1 - параметры распознаны и согласованы; 0 - описание ошибки в error </returns>
+bool config_t::ParseArgs(int argc, char* argv[])
+{
+    static const char* positional[] = { "port", "admin_port", "trace_sample" }; // старый вид командной строки
+
+    int i = 1;
+    for (size_t pos = 0; i < argc && pos < sizeof(positional) / sizeof(positional[0]) && std::strncmp(argv[i], "--", 2) != 0; ++i, ++pos)
+        if (!Set(positional[pos], argv[i]))
+            return false;
+
+    for (; i < argc; i += 2)
+    {
+        if (std::strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc)
+        {
+            error = std::string("expected '--key value' at '") + argv[i] + "'";
+            return false;
+        }
+        std::string key(argv[i] + 2);
+        if (!(key == "config" ? LoadFile(argv[i + 1]) : Set(key, argv[i + 1])))
+            return false;
+    }
+
+    return check();
+}
+
+/// <summary>
+/// Метод вывода параметров в текстовом виде "config.ключ значение"
+/// </summary>
+/// <param name="buf"> - буфер для вывода </param>
+void config_t::Print(std::string& buf) const
+{
+    buf += "config.listen " + listen + ':' + std::to_string(port)
+        + "\nconfig.admin_listen " + adminListen + ':' + std::to_string(adminPort)
+        + "\nconfig.trace_sample " + std::to_string(traceSample)
+        + "\nconfig.max_clients " + std::to_string(maxClients)
+        + "\nconfig.pool_threads " + std::to_string(poolThreads)
+        + "\nconfig.recv_chunk " + std::to_string(recvChunk)
+        + "\nconfig.max_frame " + std::to_string(maxFrame)
+        + "\nconfig.session_arena " + std::to_string(sessionArena)
+        + "\nconfig.backlog " + std::to_string(backlog)
+        + "\nconfig.accept_batch " + std::to_string(acceptBatch)
+        + "\nconfig.conn_rate " + std::to_string(connRate) + " burst " + std::to_string(connBurst)
+        + "\nconfig.conn_rate_ip " + std::to_string(connRateIP) + " burst " + std::to_string(connBurstIP)
+        + "\nconfig.conn_max_ip " + std::to_string(connMaxIP)
+        + "\nconfig.admission_table " + std::to_string(admissionTable)
+        + "\nconfig.msg_rate " + std::to_string(msgRate) + " burst " + std::to_string(msgBurst)
+        + "\nconfig.byte_rate " + std::to_string(byteRate) + " burst " + std::to_string(byteBurst)
+        + "\nconfig.ping_interval_ms " + std::to_string(pingIntervalMs)
+        + "\nconfig.idle_timeout_ms " + std::to_string(idleTimeoutMs)
+        + "\nconfig.write_stall_ms " + std::to_string(writeStallMs)
+        + "\nconfig.drain_timeout_ms " + std::to_string(drainTimeoutMs)
+        + "\nconfig.handoff_path " + handoffPath
+        + "\nconfig.takeover " + std::to_string(takeover)
+        + "\nconfig.history_dir " + historyDir
+        + "\nconfig.history_fsync " + historyFsync + " ms " + std::to_string(historyFsyncMs)
+            + " every " + std::to_string(historyFsyncEvery)
+        + "\nconfig.history_segment_mb " + std::to_string(historySegmentMb)
+        + "\nconfig.history_replay " + std::to_string(historyReplay)
+        + "\nconfig.socket_profile " + socketProfile + '\n';
+}
+
+/// <summary>
+/// Метод итоговой проверки согласованности параметров
+/// </summary>
+/// <returns> 1 - параметры согласованы </returns>
+bool config_t::check()
+{
+    if (poolThreads == 0)
+        poolThreads = maxClients;
+
+    if (port == 0)
+        error = "port is not set";
+    else if (adminPort == port)
+        error = "admin_port must differ from port";
+    else if (idleTimeoutMs != 0 && pingIntervalMs >= idleTimeoutMs)
+        error = "ping_interval_ms must be < idle_timeout_ms (the client needs time to answer [PING])";
+#ifdef __WIN32__
+    else if (!handoffPath.empty())
+        error = "handoff_path is supported on POSIX only";
+#endif
+    else if (takeover && handoffPath.empty())
+        error = "takeover requires handoff_path";
+    else if (historyReplay != 0 && historyDir.empty())
+        error = "history_replay requires history_dir";
+    else if (poolThreads < maxClients)
+        error = "pool_threads must be >= max_clients (a session holds its thread for the whole connection)";
+    else
+        return true;
+    return false;
+}
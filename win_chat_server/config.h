@@ -0,0 +1,116 @@
+﻿#pragma once
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <string>
+#include <cstddef>
+
+#define CONFIG_LISTEN "127.0.0.1" // адрес прослушивания по умолчанию
+#define CONFIG_MAX_CLIENTS 2 // максимальное количество собеседников по умолчанию
+#define CONFIG_RECV_CHUNK 16384 // размер одного чтения из сокета по умолчанию, байт
+#define CONFIG_MAX_FRAME 65536 // предельный размер входящего кадра по умолчанию, байт
+#define CONFIG_SESSION_ARENA 1024 // начальный блок арены сессии по умолчанию, байт
+#define CONFIG_BACKLOG 128 // длина очереди ожидающих подключений по умолчанию
+#define CONFIG_ACCEPT_BATCH 64 // подключений за одно пробуждение ацептора по умолчанию
+#define CONFIG_CONN_RATE 1000 // общая частота подключений по умолчанию, в секунду
+#define CONFIG_CONN_RATE_IP 50 // частота подключений с одного адреса по умолчанию, в секунду
+#define CONFIG_ADMISSION_TABLE 4096 // слотов таблицы адресов допуска по умолчанию
+#define CONFIG_MSG_RATE 2000 // входящих сообщений одного собеседника по умолчанию, в секунду
+#define CONFIG_BYTE_RATE (1 << 20) // входящих байт одного собеседника по умолчанию, в секунду
+#define CONFIG_PING_INTERVAL_MS 30000 // тишина собеседника до проверки связи [PING] по умолчанию, мс
+#define CONFIG_IDLE_TIMEOUT_MS 90000 // тишина собеседника до отключения по умолчанию, мс
+#define CONFIG_WRITE_STALL_MS 10000 // зависание записи в сокет собеседника до отключения по умолчанию, мс
+#define CONFIG_DRAIN_TIMEOUT_MS 5000 // ожидание отключения собеседников при плавной остановке по умолчанию, мс
+#define CONFIG_HISTORY_FSYNC "interval" // политика сброса журнала истории на диск по умолчанию (history_t::policy_t)
+#define CONFIG_HISTORY_FSYNC_MS 1000 // интервал сброса журнала истории по умолчанию, мс
+#define CONFIG_HISTORY_FSYNC_EVERY 1000 // сообщений между сбросами журнала истории по умолчанию
+#define CONFIG_HISTORY_SEGMENT_MB 64 // размер сегмента журнала истории по умолчанию, МБ
+#define CONFIG_SOCKET_PROFILE "low_latency" // профиль настройки сокетов чата по умолчанию (network::sockProfile_t)
+
+/// <summary>
+/// Параметры сервера. Источники применяются по порядку, более поздний перекрывает ранний:
+/// значения по умолчанию -> файл "ключ = значение" (--config) -> ключи командной строки "--ключ значение".
+/// Старый вид командной строки "порт [порт_админки [трасса_1_из_N]]" тоже принимается
+/// </summary>
+struct config_t
+{
+    /// <summary>
+    /// конструктор: значения по умолчанию
+    /// </summary>
+    config_t();
+
+    /// <summary>
+    /// Метод установки одного параметра по имени (в командной строке '-' в имени равен '_')
+    /// </summary>
+    /// <param name="key"> - имя параметра </param>
+    /// <param name="value"> - значение </param>
+    /// <returns> 1 - параметр распознан и значение корректно; 0 - описание ошибки в error </returns>
+    bool Set(std::string key, const std::string& value);
+
+    /// <summary>
+    /// Метод чтения файла параметров: строки "ключ = значение", '#' - комментарий до конца строки
+    /// </summary>
+    /// <param name="fileName"> - имя файла </param>
+    /// <returns> 1 - файл прочитан; 0 - описание ошибки в error </returns>
+    bool LoadFile(const std::string& fileName);
+
+    /// <summary>
+    /// Метод разбора командной строки с итоговой проверкой параметров
+    /// </summary>
+    /// <param name="argc"> - количество параметров </param>
+    /// <param name="argv"> - массив параметров </param>
+    /// <returns> 1 - параметры распознаны и согласованы; 0 - описание ошибки в error </returns>
+    bool ParseArgs(int argc, char* argv[]);
+
+    /// <summary>
+    /// Метод вывода параметров в текстовом виде "config.ключ значение"
+    /// </summary>
+    /// <param name="buf"> - буфер для вывода </param>
+    void Print(std::string& buf) const;
+
+    std::string listen; // адрес прослушивания чата
+    unsigned port; // порт чата
+    std::string adminListen; // адрес административного интерфейса
+    unsigned adminPort; // порт административного интерфейса (0 - не запускать)
+    unsigned traceSample; // трассируем каждое traceSample-ое сообщение (0 - трасса выключена)
+    size_t maxClients; // максимальное количество собеседников, под него все резервируется при старте
+    size_t poolThreads; // потоков в пуле (сессия занимает поток на все соединение, 0 - по maxClients)
+    size_t recvChunk; // размер одного чтения из сокета, байт
+    size_t maxFrame; // предельный размер входящего кадра вместе с разделителем, байт (0 - без предела), длиннее - разрыв
+    size_t sessionArena; // начальный блок арены сессии, байт
+    int backlog; // длина очереди ожидающих подключений
+    size_t acceptBatch; // подключений, принимаемых за одно пробуждение ацептора
+    unsigned connRate; // общая частота подключений, в секунду (0 - без ограничения)
+    unsigned connBurst; // общий запас подключений сверх частоты
+    unsigned connRateIP; // частота подключений с одного адреса, в секунду (0 - без ограничения)
+    unsigned connBurstIP; // запас подключений одного адреса
+    unsigned connMaxIP; // одновременных подключений с одного адреса (0 - без ограничения)
+    size_t admissionTable; // слотов таблицы адресов допуска
+    unsigned msgRate; // входящих сообщений одного собеседника, в секунду (0 - без ограничения)
+    unsigned msgBurst; // запас входящих сообщений одного собеседника
+    unsigned byteRate; // входящих байт одного собеседника, в секунду (0 - без ограничения)
+    unsigned byteBurst; // запас входящих байт одного собеседника
+    unsigned pingIntervalMs; // тишина собеседника до проверки связи [PING], мс (0 - не проверять)
+    unsigned idleTimeoutMs; // тишина собеседника до отключения, мс (0 - не отключать)
+    unsigned writeStallMs; // зависание записи в сокет собеседника до отключения, мс (0 - не отключать)
+    unsigned drainTimeoutMs; // ожидание отключения уведомленных собеседников при остановке, мс (0 - рвать сразу)
+    std::string handoffPath; // unix-сокет передачи соединений новому процессу при перезапуске (пусто - выключено, только POSIX)
+    bool takeover; // при старте забрать слушающий сокет и соединения у процесса, ждущего на handoffPath
+    std::string historyDir; // каталог журнала истории сообщений комнат (пусто - история не пишется)
+    std::string historyFsync; // политика сброса журнала на диск: none, interval, every
+    unsigned historyFsyncMs; // интервал сброса журнала для interval, мс
+    unsigned historyFsyncEvery; // сообщений между сбросами журнала для every
+    unsigned historySegmentMb; // размер сегмента журнала, МБ
+    unsigned historyReplay; // последних сообщений комнаты, показываемых входящему в нее собеседнику (0 - не показывать)
+    std::string socketProfile; // профиль настройки слушающего и принятых сокетов чата: low_latency, low_latency_busy_poll, bulk, federation
+
+    std::string error; // описание последней ошибки разбора
+protected:
+    /// <summary>
+    /// Метод итоговой проверки согласованности параметров
+    /// </summary>
+    /// <returns> 1 - параметры согласованы </returns>
+    bool check();
+};
+
+#endif /* CONFIG_H_ */
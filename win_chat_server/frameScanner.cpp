@@ -0,0 +1,218 @@
+﻿#include "frameScanner.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRAMESCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2 // MSVC разрешает AVX2 интринсики без ключей компиляции
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+/// <summary>
+/// тип функции поиска: кандидаты на начало разделителя - позиции [from, last]
+/// </summary>
+typedef size_t(*scan_f)(const char* data, size_t from, size_t last, const char* delimiter, size_t size, frameEnds_t& q_end);
+
+/// <summary>
+/// Функция проверки середины разделителя (первый и последний символ уже совпали)
+/// </summary>
+/// <param name="pos"> - начало кандидата </param>
+/// <param name="delimiter"> - разделитель </param>
+/// <param name="size"> - размер разделителя </param>
+/// <returns> 1 - разделитель найден </returns>
+static inline bool matchMiddle(const char* pos, const char* delimiter, size_t size)
+{
+    return size <= 2 || 0 == std::memcmp(pos + 1, delimiter + 1, size - 2);
+}
+
+/// <summary>
+/// Функция номера младшего установленного бита
+/// </summary>
+/// <param name="mask"> - ненулевая маска </param>
+/// <returns> номер бита </returns>
+static inline unsigned lowBit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/// <summary>
+/// Скалярный поиск: memchr по первому символу, затем сверка разделителя
+/// </summary>
+static size_t scanScalar(const char* data, size_t from, size_t last, const char* delimiter, size_t size, frameEnds_t& q_end)
+{
+    size_t result = 0;
+    size_t pos = from;
+    while (pos <= last)
+    {
+        const char* found = static_cast<const char*>(std::memchr(data + pos, delimiter[0], last - pos + 1));
+        if (found == nullptr)
+            break;
+        pos = found - data;
+        if (data[pos + size - 1] == delimiter[size - 1] && matchMiddle(data + pos, delimiter, size))
+        {
+            q_end.push_back(pos + size);
+            ++result;
+            pos += size; // разделители не перекрываются
+        }
+        else
+            ++pos;
+    }
+    return result;
+}
+
+#ifdef FRAMESCANNER_X86
+/// <summary>
+/// Поиск SSE2: 16 кандидатов за шаг, совпадение первого и последнего символа разделителя
+/// </summary>
+static size_t scanSSE2(const char* data, size_t from, size_t last, const char* delimiter, size_t size, frameEnds_t& q_end)
+{
+    size_t result = 0;
+    size_t pos = from; // начало текущего блока
+    size_t next = from; // кандидаты до этой позиции перекрыты найденным разделителем
+    const __m128i first = _mm_set1_epi8(delimiter[0]);
+    const __m128i tail = _mm_set1_epi8(delimiter[size - 1]);
+
+    for (; pos + 16 <= last + 1; pos += 16)
+    {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i blockTail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + size - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockTail, tail)));
+        while (mask)
+        {
+            size_t candidate = pos + lowBit(mask);
+            mask &= mask - 1;
+            if (candidate >= next && matchMiddle(data + candidate, delimiter, size))
+            {
+                q_end.push_back(candidate + size);
+                ++result;
+                next = candidate + size;
+            }
+        }
+    }
+
+    if (next < pos) next = pos;
+    return result + (next <= last ? scanScalar(data, next, last, delimiter, size, q_end) : 0);
+}
+
+/// <summary>
+/// Поиск AVX2: 32 кандидата за шаг
+/// </summary>
+TARGET_AVX2 static size_t scanAVX2(const char* data, size_t from, size_t last, const char* delimiter, size_t size, frameEnds_t& q_end)
+{
+    size_t result = 0;
+    size_t pos = from;
+    size_t next = from;
+    const __m256i first = _mm256_set1_epi8(delimiter[0]);
+    const __m256i tail = _mm256_set1_epi8(delimiter[size - 1]);
+
+    for (; pos + 32 <= last + 1; pos += 32)
+    {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i blockTail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + size - 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockTail, tail))));
+        while (mask)
+        {
+            size_t candidate = pos + lowBit(mask);
+            mask &= mask - 1;
+            if (candidate >= next && matchMiddle(data + candidate, delimiter, size))
+            {
+                q_end.push_back(candidate + size);
+                ++result;
+                next = candidate + size;
+            }
+        }
+    }
+
+    if (next < pos) next = pos;
+    return result + (next <= last ? scanSSE2(data, next, last, delimiter, size, q_end) : 0);
+}
+
+/// <summary>
+/// Функция проверки поддержки AVX2 процессором и ОС
+/// </summary>
+/// <returns> 1 - AVX2 доступен </returns>
+static bool supportAVX2()
+{
+#ifdef _MSC_VER
+    int info[4] = { 0 };
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0) // OSXSAVE: ОС сохраняет регистры AVX
+        return false;
+    if ((_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+/// <summary>
+/// Функция выбора лучшей реализации поиска
+/// </summary>
+/// <param name="name"> - ссылка на имя выбранной реализации </param>
+/// <returns> функция поиска </returns>
+static scan_f selectScan(const char*& name)
+{
+#ifdef FRAMESCANNER_X86
+    if (supportAVX2())
+    {
+        name = "avx2";
+        return scanAVX2;
+    }
+    name = "sse2";
+    return scanSSE2;
+#else
+    name = "scalar";
+    return scanScalar;
+#endif
+}
+
+static const char* scanName = "scalar"; // имя выбранной реализации
+static scan_f scanBest = selectScan(scanName); // выбор реализации при загрузке программы
+static scan_f scanActive = scanBest; // используемая реализация
+
+/// <summary>
+/// Метод поиска всех разделителей в диапазоне [from, size)
+/// </summary>
+/// <param name="data"> - начало буфера </param>
+/// <param name="size"> - размер буфера </param>
+/// <param name="from"> - позиция, с которой начинать поиск (байты до нее уже просмотрены) </param>
+/// <param name="delimiter"> - разделитель кадров </param>
+/// <param name="q_end"> - очередь, куда добавляются позиции концов кадров (сразу за разделителем) </param>
+/// <returns> количество найденных разделителей </returns>
+size_t frameScanner_t::Scan(const char* data, size_t size, size_t from, const std::string& delimiter, frameEnds_t& q_end)
+{
+    if (delimiter.empty() || size < delimiter.size() || from > size - delimiter.size())
+        return 0;
+    return scanActive(data, from, size - delimiter.size(), delimiter.data(), delimiter.size(), q_end);
+}
+
+/// <summary>
+/// Метод получения имени выбранной реализации
+/// </summary>
+/// <returns> "avx2", "sse2" или "scalar" </returns>
+const char* frameScanner_t::Name()
+{
+    return scanActive == scanScalar ? "scalar" : scanName;
+}
+
+/// <summary>
+/// Метод принудительного выбора скалярной реализации (для сравнения в замерах)
+/// </summary>
+/// <param name="b_scalar"> - 1 - только скалярный поиск, 0 - лучшая доступная реализация </param>
+void frameScanner_t::ForceScalar(bool b_scalar)
+{
+    scanActive = b_scalar ? scanScalar : scanBest;
+}
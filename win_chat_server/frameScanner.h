@@ -0,0 +1,43 @@
+﻿#pragma once
+#ifndef FRAMESCANNER_H_
+#define FRAMESCANNER_H_
+
+#include <string>
+#include <deque>
+#include "memPool.h"
+
+typedef std::deque<size_t, poolAllocator_t<size_t>> frameEnds_t; // очередь концов кадров (блоки очереди из общего пула)
+
+/// <summary>
+/// Поиск разделителей кадров ("[EOM]") в принятых данных.
+/// Кандидаты отбираются векторно (AVX2 / SSE2) по первому и последнему символу разделителя,
+/// реализация выбирается один раз по возможностям процессора, без SIMD - скалярный поиск
+/// </summary>
+class frameScanner_t
+{
+public:
+    /// <summary>
+    /// Метод поиска всех разделителей в диапазоне [from, size)
+    /// </summary>
+    /// <param name="data"> - начало буфера </param>
+    /// <param name="size"> - размер буфера </param>
+    /// <param name="from"> - позиция, с которой начинать поиск (байты до нее уже просмотрены) </param>
+    /// <param name="delimiter"> - разделитель кадров </param>
+    /// <param name="q_end"> - очередь, куда добавляются позиции концов кадров (сразу за разделителем) </param>
+    /// <returns> количество найденных разделителей </returns>
+    static size_t Scan(const char* data, size_t size, size_t from, const std::string& delimiter, frameEnds_t& q_end);
+
+    /// <summary>
+    /// Метод получения имени выбранной реализации
+    /// </summary>
+    /// <returns> "avx2", "sse2" или "scalar" </returns>
+    static const char* Name();
+
+    /// <summary>
+    /// Метод принудительного выбора скалярной реализации (для сравнения в замерах)
+    /// </summary>
+    /// <param name="b_scalar"> - 1 - только скалярный поиск, 0 - лучшая доступная реализация </param>
+    static void ForceScalar(bool b_scalar);
+};
+
+#endif /* FRAMESCANNER_H_ */
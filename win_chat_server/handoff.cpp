@@ -0,0 +1,350 @@
+﻿#include "handoff.h"
+
+#include <algorithm>
+
+#ifndef __WIN32__
+#include <sys/un.h>
+#include <signal.h>
+#endif
+
+namespace
+{
+    /// <summary>
+    /// дописывание числа в сообщение передачи (процессы на одной машине - порядок байт родной)
+    /// </summary>
+    template<class Number>
+    void putNumber(std::string& buf, Number number)
+    {
+        buf.append(reinterpret_cast<const char*>(&number), sizeof(number));
+    }
+
+    /// <summary>
+    /// чтение числа из сообщения передачи
+    /// </summary>
+    /// <returns> 1 - в сообщении хватило байт </returns>
+    template<class Number>
+    bool getNumber(const std::string& buf, size_t& r_offset, Number& r_number)
+    {
+        if (buf.size() - r_offset < sizeof(r_number))
+            return false;
+        std::memcpy(&r_number, buf.data() + r_offset, sizeof(r_number));
+        r_offset += sizeof(r_number);
+        return true;
+    }
+
+#ifndef __WIN32__
+    /// <summary>
+    /// обработчик сигнала прерывания: ничего не делает, его дело - EINTR в recv потока сессии
+    /// </summary>
+    void onInterrupt(int)
+    {}
+
+    /// <summary>
+    /// заполнение адреса unix-сокета
+    /// </summary>
+    /// <returns> 1 - путь помещается в адрес </returns>
+    bool unixAddress(const std::string& path, sockaddr_un& r_addr)
+    {
+        std::memset(&r_addr, 0, sizeof(r_addr));
+        r_addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(r_addr.sun_path))
+            return false;
+        std::memcpy(r_addr.sun_path, path.data(), path.size());
+        return true;
+    }
+#endif
+}
+
+/// <summary>
+/// конструктор
+/// </summary>
+/// <param name="path"> - путь unix-сокета передачи </param>
+/// <param name="logger"> - объект логгирования </param>
+handoff_t::handoff_t(std::string path, log_t& logger) : path(std::move(path)), logger(logger), listener(INVALID_SOCKET), peer(INVALID_SOCKET)
+{}
+
+handoff_t::~handoff_t()
+{
+    if (peer != INVALID_SOCKET)
+        CLOSE_SOCKET(peer);
+    if (listener != INVALID_SOCKET)
+    { // преемник не приходил: файл сокета наш
+        CLOSE_SOCKET(listener);
+#ifndef __WIN32__
+        unlink(path.c_str());
+#endif
+    }
+}
+
+/// <summary>
+/// Метод открытия точки ожидания преемника (прошлый файл сокета удаляется)
+/// </summary>
+/// <returns> 1 - точка открыта </returns>
+bool handoff_t::Listen()
+{
+#ifdef __WIN32__
+    logger.doLog("handoff is not supported on Windows");
+    return false;
+#else
+    sockaddr_un addr;
+    if (!unixAddress(path, addr))
+    {
+        logger.doLog("handoff path is too long: " + path);
+        return false;
+    }
+    unlink(path.c_str()); // файл прошлого процесса: его точку ожидания мы уже прошли либо он завершился
+    listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listener == INVALID_SOCKET || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) || listen(listener, 1))
+    {
+        logger.doLog("handoff listen fail, errno: ", errno);
+        if (listener != INVALID_SOCKET)
+            CLOSE_SOCKET(listener);
+        listener = INVALID_SOCKET;
+        return false;
+    }
+    return true;
+#endif
+}
+
+/// <summary>
+/// Метод ожидания преемника: после его подключения точка ожидания закрывается
+/// </summary>
+/// <param name="wakeup"> - событие, прерывающее ожидание </param>
+/// <returns> 1 - преемник подключился; 0 - взведено событие либо ошибка </returns>
+bool handoff_t::Wait(const network::wakeup_t& wakeup)
+{
+#ifdef __WIN32__
+    return false;
+#else
+    while (listener != INVALID_SOCKET)
+    {
+        pollfd fd[2] = { { listener, POLLIN, 0 }, { wakeup.Handle(), POLLIN, 0 } };
+        int ready = poll(fd, 2, -1);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready < 0)
+        {
+            logger.doLog("handoff poll fail, errno: ", errno);
+            return false;
+        }
+        if (fd[1].revents != 0)
+            return false; // остановка сервера
+
+        peer = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (peer == INVALID_SOCKET)
+            continue; // преемник ушел раньше, чем мы его приняли
+        // второго преемника не ждем; файл сокета теперь принадлежит преемнику, он откроет свою точку сам
+        CLOSE_SOCKET(listener);
+        listener = INVALID_SOCKET;
+        timeval timeout = { HANDOFF_RECV_TIMEOUT_S, 0 };
+        setsockopt(peer, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return true;
+    }
+    return false;
+#endif
+}
+
+/// <summary>
+/// Метод передачи состояния подключившемуся преемнику с ожиданием подтверждения.
+/// Свои копии дескрипторов вызывающий закрывает сам в любом случае
+/// </summary>
+/// <param name="state"> - состояние сервера </param>
+/// <returns> 1 - преемник принял состояние </returns>
+bool handoff_t::Send(const handoffState_t& state)
+{
+    if (peer == INVALID_SOCKET)
+        return false;
+
+    std::string buf;
+    putNumber(buf, HANDOFF_MAGIC);
+    putNumber(buf, state.sessionID);
+    putNumber(buf, static_cast<unsigned long long>(state.v_session.size()));
+    if (!sendMsg(buf, state.listen))
+        return false;
+
+    for (const handoffSession_t& session : state.v_session)
+    { // сокет клиента - вместе с заголовком сессии, хвост приема - следом кусками
+        size_t first = std::min(session.pending.size(), static_cast<size_t>(HANDOFF_CHUNK));
+        buf.clear();
+        putNumber(buf, session.id);
+        putNumber(buf, static_cast<unsigned>(session.room.size()));
+        putNumber(buf, static_cast<unsigned>(session.pending.size()));
+        buf += session.room;
+        buf.append(session.pending, 0, first);
+        if (!sendMsg(buf, session.socket))
+            return false;
+        for (size_t offset = first; offset < session.pending.size(); offset += HANDOFF_CHUNK)
+            if (!sendMsg(std::string_view(session.pending).substr(offset, HANDOFF_CHUNK), INVALID_SOCKET))
+                return false;
+    }
+
+    std::string ack;
+    SOCKET fd = INVALID_SOCKET;
+    return recvMsg(ack, fd) && ack == "K";
+}
+
+/// <summary>
+/// Метод приема состояния у прошлого процесса (вызывает преемник при старте)
+/// </summary>
+/// <param name="r_state"> - принятое состояние, дескрипторы принадлежат вызывающему </param>
+/// <returns> 1 - состояние принято и подтверждено </returns>
+bool handoff_t::Receive(handoffState_t& r_state)
+{
+#ifdef __WIN32__
+    logger.doLog("handoff is not supported on Windows");
+    return false;
+#else
+    sockaddr_un addr;
+    if (!unixAddress(path, addr))
+    {
+        logger.doLog("handoff path is too long: " + path);
+        return false;
+    }
+    peer = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (peer == INVALID_SOCKET || connect(peer, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+    {
+        logger.doLog("handoff connect fail, errno: ", errno);
+        return false;
+    }
+    timeval timeout = { HANDOFF_RECV_TIMEOUT_S, 0 };
+    setsockopt(peer, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string buf;
+    size_t offset = 0;
+    unsigned long long magic = 0, count = 0;
+    bool b_ok = recvMsg(buf, r_state.listen) && getNumber(buf, offset, magic) && magic == HANDOFF_MAGIC
+        && getNumber(buf, offset, r_state.sessionID) && getNumber(buf, offset, count) && r_state.listen != INVALID_SOCKET;
+
+    for (unsigned long long i = 0; b_ok && i < count; ++i)
+    {
+        handoffSession_t session;
+        unsigned roomSize = 0, pendingSize = 0;
+        offset = 0;
+        b_ok = recvMsg(buf, session.socket) && getNumber(buf, offset, session.id) && getNumber(buf, offset, roomSize)
+            && getNumber(buf, offset, pendingSize) && buf.size() - offset >= roomSize;
+        if (session.socket != INVALID_SOCKET)
+            r_state.v_session.push_back(session); // дескриптор учтен сразу: при ошибке его закроем вместе с остальными
+        if (!b_ok || session.socket == INVALID_SOCKET)
+            break;
+
+        handoffSession_t& added = r_state.v_session.back();
+        added.room.assign(buf, offset, roomSize);
+        added.pending.assign(buf, offset + roomSize, std::string::npos);
+        while (b_ok && added.pending.size() < pendingSize)
+        {
+            SOCKET fd = INVALID_SOCKET;
+            b_ok = recvMsg(buf, fd) && fd == INVALID_SOCKET && !buf.empty();
+            added.pending += buf;
+        }
+        b_ok = b_ok && added.pending.size() == pendingSize;
+    }
+
+    if (b_ok && r_state.v_session.size() == count && sendMsg("K", INVALID_SOCKET))
+        return true;
+
+    logger.doLog("handoff receive fail, errno: ", errno);
+    if (r_state.listen != INVALID_SOCKET)
+        CLOSE_SOCKET(r_state.listen);
+    for (handoffSession_t& session : r_state.v_session)
+        CLOSE_SOCKET(session.socket);
+    r_state = handoffState_t();
+    return false;
+#endif
+}
+
+/// <summary>
+/// Метод установки обработчика сигнала прерывания потоков сессий: пустой, без SA_RESTART,
+/// чтобы блокирующий recv вернул EINTR
+/// </summary>
+/// <returns> номер сигнала (0 - не поддерживается) </returns>
+int handoff_t::InstallInterrupt()
+{
+#ifdef __WIN32__
+    return 0;
+#else
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = onInterrupt;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR2, &action, nullptr);
+    return SIGUSR2;
+#endif
+}
+
+/// <summary>
+/// Метод отправки одного сообщения передачи
+/// </summary>
+/// <param name="data"> - данные сообщения </param>
+/// <param name="fd"> - прикладываемый дескриптор (INVALID_SOCKET - без дескриптора) </param>
+/// <returns> 1 - сообщение отправлено </returns>
+bool handoff_t::sendMsg(std::string_view data, SOCKET fd)
+{
+#ifdef __WIN32__
+    return false;
+#else
+    iovec iov = { const_cast<char*>(data.data()), data.size() };
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    if (fd != INVALID_SOCKET)
+    {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    ssize_t sent;
+    while ((sent = sendmsg(peer, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+        ;
+    if (sent == static_cast<ssize_t>(data.size()))
+        return true;
+    logger.doLog("handoff send fail, errno: ", errno);
+    return false;
+#endif
+}
+
+/// <summary>
+/// Метод приема одного сообщения передачи
+/// </summary>
+/// <param name="r_data"> - данные сообщения </param>
+/// <param name="r_fd"> - приложенный дескриптор (INVALID_SOCKET - без дескриптора) </param>
+/// <returns> 1 - сообщение принято </returns>
+bool handoff_t::recvMsg(std::string& r_data, SOCKET& r_fd)
+{
+    r_fd = INVALID_SOCKET;
+#ifdef __WIN32__
+    return false;
+#else
+    r_data.resize(HANDOFF_CHUNK + 64); // заголовок сессии с именем комнаты и первый кусок хвоста приема
+    iovec iov = { &r_data[0], r_data.size() };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    while ((received = recvmsg(peer, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+        ;
+    if (received <= 0)
+    {
+        r_data.clear();
+        return false;
+    }
+    r_data.resize(received);
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+            std::memcpy(&r_fd, CMSG_DATA(cmsg), sizeof(int));
+    return (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) == 0;
+#endif
+}
@@ -0,0 +1,117 @@
+﻿#pragma once
+#ifndef HANDOFF_H_
+#define HANDOFF_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "network.h"
+
+#define HANDOFF_MAGIC 0x3146464F54414843ull // "CHATOFF1": начало передачи, и версия формата
+#define HANDOFF_CHUNK 32768 // байт состояния в одном сообщении передачи
+#define HANDOFF_RECV_TIMEOUT_S 60 // ожидание очередного сообщения от прошлого процесса, с
+
+/// <summary>
+/// сессия, передаваемая новому процессу
+/// </summary>
+struct handoffSession_t
+{
+    SOCKET socket; // дескриптор соединения с клиентом
+    unsigned long long id; // номер соединения (адрес личных сообщений)
+    std::string room; // комната собеседника
+    std::string pending; // принятые, но еще не выданные кадрами байты - кадровое состояние приема
+};
+
+/// <summary>
+/// состояние сервера, передаваемое новому процессу
+/// </summary>
+struct handoffState_t
+{
+    handoffState_t() : listen(INVALID_SOCKET), sessionID(0)
+    {}
+
+    SOCKET listen; // слушающий сокет чата
+    unsigned long long sessionID; // последний выданный номер соединения
+    std::vector<handoffSession_t> v_session; // живые сессии
+};
+
+/// <summary>
+/// Передача работающего сервера новому процессу без разрыва соединений (POSIX). Прошлый процесс ждет преемника
+/// на unix-сокете SOCK_SEQPACKET, преемник подключается и получает слушающий сокет и сокеты клиентов через
+/// SCM_RIGHTS: по одному дескриптору на сообщение, вместе с состоянием его сессии, и подтверждает прием.
+/// На Windows не поддерживается (методы возвращают 0)
+/// </summary>
+class handoff_t
+{
+public:
+    /// <summary>
+    /// конструктор
+    /// </summary>
+    /// <param name="path"> - путь unix-сокета передачи </param>
+    /// <param name="logger"> - объект логгирования </param>
+    handoff_t(std::string path, log_t& logger);
+
+    handoff_t(const handoff_t&) = delete;
+    handoff_t& operator=(const handoff_t&) = delete;
+
+    ~handoff_t();
+
+    /// <summary>
+    /// Метод открытия точки ожидания преемника (прошлый файл сокета удаляется)
+    /// </summary>
+    /// <returns> 1 - точка открыта </returns>
+    bool Listen();
+
+    /// <summary>
+    /// Метод ожидания преемника: после его подключения точка ожидания закрывается
+    /// </summary>
+    /// <param name="wakeup"> - событие, прерывающее ожидание </param>
+    /// <returns> 1 - преемник подключился; 0 - взведено событие либо ошибка </returns>
+    bool Wait(const network::wakeup_t& wakeup);
+
+    /// <summary>
+    /// Метод передачи состояния подключившемуся преемнику с ожиданием подтверждения.
+    /// Свои копии дескрипторов вызывающий закрывает сам в любом случае
+    /// </summary>
+    /// <param name="state"> - состояние сервера </param>
+    /// <returns> 1 - преемник принял состояние </returns>
+    bool Send(const handoffState_t& state);
+
+    /// <summary>
+    /// Метод приема состояния у прошлого процесса (вызывает преемник при старте)
+    /// </summary>
+    /// <param name="r_state"> - принятое состояние, дескрипторы принадлежат вызывающему </param>
+    /// <returns> 1 - состояние принято и подтверждено </returns>
+    bool Receive(handoffState_t& r_state);
+
+    /// <summary>
+    /// Метод установки обработчика сигнала прерывания потоков сессий: пустой, без SA_RESTART,
+    /// чтобы блокирующий recv вернул EINTR
+    /// </summary>
+    /// <returns> номер сигнала (0 - не поддерживается) </returns>
+    static int InstallInterrupt();
+private:
+    /// <summary>
+    /// Метод отправки одного сообщения передачи
+    /// </summary>
+    /// <param name="data"> - данные сообщения </param>
+    /// <param name="fd"> - прикладываемый дескриптор (INVALID_SOCKET - без дескриптора) </param>
+    /// <returns> 1 - сообщение отправлено </returns>
+    bool sendMsg(std::string_view data, SOCKET fd);
+
+    /// <summary>
+    /// Метод приема одного сообщения передачи
+    /// </summary>
+    /// <param name="r_data"> - данные сообщения </param>
+    /// <param name="r_fd"> - приложенный дескриптор (INVALID_SOCKET - без дескриптора) </param>
+    /// <returns> 1 - сообщение принято </returns>
+    bool recvMsg(std::string& r_data, SOCKET& r_fd);
+
+    const std::string path; // путь unix-сокета передачи
+    log_t& logger; // объект логгирования
+    SOCKET listener; // точка ожидания преемника
+    SOCKET peer; // соединение с другим процессом
+};
+
+#endif /* HANDOFF_H_ */
@@ -0,0 +1,630 @@
+﻿#include "history.h"
+
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstdio>
+
+#ifdef __WIN32__
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /// <summary>
+    /// открытие файла на дописывание (создается при отсутствии)
+    /// </summary>
+    /// <returns> дескриптор файла; -1 - ошибка (errno) </returns>
+    int openAppend(const std::string& path)
+    {
+#ifdef __WIN32__
+        return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    }
+
+    /// <summary>
+    /// запись буфера целиком
+    /// </summary>
+    /// <returns> 1 - записан весь буфер </returns>
+    bool writeAll(int fd, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+#ifdef __WIN32__
+            int written = _write(fd, data, static_cast<unsigned>(std::min<size_t>(size, 1u << 30)));
+#else
+            ssize_t written = write(fd, data, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+#endif
+            if (written <= 0)
+                return false;
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// сброс данных файла на диск
+    /// </summary>
+    /// <returns> 1 - сброшено </returns>
+    bool syncFile(int fd)
+    {
+#ifdef __WIN32__
+        return _commit(fd) == 0;
+#elif defined(__linux__)
+        return fdatasync(fd) == 0; // метаданные, кроме размера, для чтения журнала не нужны
+#else
+        return fsync(fd) == 0;
+#endif
+    }
+
+    /// <summary>
+    /// закрытие файла
+    /// </summary>
+    void closeFile(int fd)
+    {
+#ifdef __WIN32__
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+
+    /// <summary>
+    /// проход по целым кадрам сегмента с позиции start до size: кадр заканчивается "[EOM]", внутри кадра его нет
+    /// </summary>
+    /// <param name="onFrame"> - вызывается с концом каждого кадра, 0 - остановить проход </param>
+    /// <returns> конец последнего пройденного целого кадра </returns>
+    template<class OnFrame>
+    unsigned long long scanFrames(const std::string& path, unsigned long long start, unsigned long long size, OnFrame onFrame)
+    {
+        static const std::string_view eom("[EOM]");
+        unsigned long long end = start;
+        std::ifstream file(path.c_str(), std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(start));
+        std::string window; // непросмотренные байты, с хвостом на случай "[EOM]" на границе чтений
+        unsigned long long windowStart = start;
+        std::vector<char> chunk(HISTORY_SCAN_CHUNK);
+        while (file && windowStart + window.size() < size)
+        {
+            file.read(chunk.data(), static_cast<std::streamsize>(std::min<unsigned long long>(chunk.size(), size - windowStart - window.size())));
+            window.append(chunk.data(), static_cast<size_t>(file.gcount()));
+
+            size_t pos = 0;
+            for (size_t found; (found = window.find(eom, pos)) != std::string::npos; )
+            {
+                pos = found + eom.size();
+                end = windowStart + pos;
+                if (!onFrame(end))
+                    return end;
+            }
+            size_t keep = std::max(pos, window.size() > eom.size() ? window.size() - eom.size() + 1 : 0);
+            windowStart += keep;
+            window.erase(0, keep);
+        }
+        return end;
+    }
+
+    /// <summary>
+    /// имя каталога комнаты: 'r' + имя в шестнадцатеричном виде (имя комнаты - любые байты, общая комната - пустое имя)
+    /// </summary>
+    std::string roomDir(std::string_view room)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string name(1, 'r');
+        for (char c : room)
+        {
+            name += digits[static_cast<unsigned char>(c) >> 4];
+            name += digits[static_cast<unsigned char>(c) & 0xF];
+        }
+        return name;
+    }
+}
+
+/// <summary>
+/// Конструктор: журнал выключен до Open()
+/// </summary>
+/// <param name="logger"> - ссылка на обект логгирования </param>
+/// <param name="metrics"> - ссылка на реестр метрик </param>
+history_t::history_t(log_t& logger, metrics_t& metrics) : logger(logger), policy(none), fsyncInterval(0), fsyncEvery(0),
+    segmentBytes(0), flushRequested(0), syncRequested(0), flushDone(0), b_stop(false), b_open(false), lastSync(0), unsyncedCount(0),
+    appended(metrics.Counter("history.appended")), dropped(metrics.Counter("history.dropped")),
+    bytes(metrics.Counter("history.bytes")), fsyncs(metrics.Counter("history.fsyncs")),
+    fsyncTime(metrics.Histogram("history.fsync_us")), batchSize(metrics.Histogram("history.batch"))
+{}
+
+/// <summary>
+/// Деструктор: дописывает очередь, сбрасывает журнал на диск и останавливает писателя
+/// </summary>
+history_t::~history_t()
+{
+    if (!writer.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mtx_queue);
+        b_stop = true;
+    }
+    cv_queue.notify_one();
+    writer.join();
+}
+
+/// <summary>
+/// Метод поиска политики сброса по имени
+/// </summary>
+/// <param name="name"> - имя политики: none, interval, every </param>
+/// <param name="r_policy"> - найденная политика </param>
+/// <returns> 1 - политика найдена </returns>
+bool history_t::FindPolicy(std::string_view name, policy_t& r_policy)
+{
+    static const char* names[] = { "none", "interval", "every" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+        if (name == names[i])
+        {
+            r_policy = static_cast<policy_t>(i);
+            return true;
+        }
+    return false;
+}
+
+/// <summary>
+/// Метод открытия журнала и запуска писателя
+/// </summary>
+/// <param name="dir"> - каталог журнала (пусто - журнал выключен) </param>
+/// <param name="policy"> - политика сброса на диск </param>
+/// <param name="fsyncMs"> - интервал сброса для interval, мс </param>
+/// <param name="fsyncEvery"> - сообщений между сбросами для every </param>
+/// <param name="segmentBytes"> - размер сегмента, после которого начинается следующий (превышается на одну группу) </param>
+/// <returns> 1 - журнал включен </returns>
+bool history_t::Open(const std::string& dir, policy_t policy, unsigned fsyncMs, unsigned fsyncEvery, unsigned long long segmentBytes)
+{
+    if (dir.empty() || b_open)
+        return false;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec)
+    {
+        logger.doLog("history_t::Open - fail create dir " + dir + ": " + ec.message());
+        return false;
+    }
+
+    this->dir = dir;
+    this->policy = policy;
+    fsyncInterval = fsyncMs * 1000ull;
+    this->fsyncEvery = fsyncEvery;
+    this->segmentBytes = segmentBytes;
+    lastSync = metrics_t::Now();
+    b_open = true;
+    writer = std::thread([this]() { writerWork(); });
+    logger.doLog("history_t::Open - journal in " + dir);
+    return true;
+}
+
+/// <summary>
+/// Метод постановки кадра сообщения в очередь журнала: не ждет диска, при переполненной очереди кадр теряется
+/// </summary>
+/// <param name="room"> - имя комнаты </param>
+/// <param name="frame"> - кадр сообщения, как он ушел собеседникам </param>
+/// <returns> 1 - кадр поставлен в очередь </returns>
+bool history_t::Append(std::string_view room, std::string_view frame)
+{
+    if (!b_open)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mtx_queue);
+    if (queue.data.size() + room.size() + frame.size() > HISTORY_QUEUE_LIMIT)
+    {
+        dropped.Add();
+        return false;
+    }
+    size_t before = queue.data.size();
+    queue.v_record.push_back(queue_t::record_t{ queue.data.size(), room.size(), frame.size() });
+    queue.data.append(room.data(), room.size()).append(frame.data(), frame.size());
+    if (before < HISTORY_WAKE_BYTES && queue.data.size() >= HISTORY_WAKE_BYTES)
+        cv_queue.notify_one(); // иначе писатель заберет очередь по своему периоду
+    return true;
+}
+
+/// <summary>
+/// Метод ожидания записи всего, что поставлено в очередь до вызова
+/// </summary>
+/// <param name="b_sync"> - дождаться и сброса на диск </param>
+void history_t::Flush(bool b_sync)
+{
+    if (!b_open)
+        return;
+
+    std::unique_lock<std::mutex> lock(mtx_queue);
+    unsigned long long request = ++flushRequested;
+    if (b_sync)
+        syncRequested = request;
+    cv_queue.notify_one();
+    cv_flushed.wait(lock, [this, request]() { return flushDone >= request; });
+}
+
+/// <summary>
+/// Метод поиска последних сообщений комнаты в журнале. Куски идут по порядку сегментов, их содержимое - готовые кадры:
+/// их можно отдавать в сокет как есть. Видно то, что писатель уже записал (см. Flush)
+/// </summary>
+/// <param name="room"> - имя комнаты </param>
+/// <param name="count"> - сколько последних сообщений нужно </param>
+/// <param name="r_slice"> - куски файлов сегментов с этими сообщениями </param>
+/// <returns> найдено сообщений (меньше count, если журнал короче) </returns>
+size_t history_t::Last(std::string_view room, size_t count, std::vector<slice_t>& r_slice)
+{
+    r_slice.clear();
+    if (!b_open || count == 0)
+        return 0;
+
+    unsigned long long from = 0; // номер первого нужного сообщения
+    unsigned long long indexed = 0; // номер сообщения ближайшей к нему записи индекса
+    size_t found = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx_rooms);
+        roomLog_t& log = openRoom(room);
+        if (log.v_segment.empty())
+            return 0;
+        found = static_cast<size_t>(std::min<unsigned long long>(count, log.next - log.v_segment.front().base));
+        if (found == 0)
+            return 0;
+        from = log.next - found;
+
+        // сегмент с первым нужным сообщением и запись его индекса не дальше этого сообщения - двоичным поиском
+        auto segment = std::upper_bound(log.v_segment.begin(), log.v_segment.end(), from,
+            [](unsigned long long seq, const segment_t& segment) { return seq < segment.base; }) - 1;
+        auto entry = std::upper_bound(segment->index.begin(), segment->index.end(), from,
+            [](unsigned long long seq, const std::pair<unsigned long long, unsigned long long>& entry) { return seq < entry.first; }) - 1;
+        indexed = entry->first;
+        r_slice.push_back(slice_t{ segmentPath(log, segment->base, ".log"), entry->second, segment->size - entry->second });
+        for (++segment; segment != log.v_segment.end(); ++segment)
+            if (segment->size != 0)
+                r_slice.push_back(slice_t{ segmentPath(log, segment->base, ".log"), 0, segment->size });
+    }
+
+    // от записи индекса до первого нужного сообщения - меньше HISTORY_INDEX_EVERY кадров, досчитываем по файлу
+    slice_t& first = r_slice.front();
+    unsigned long long skip = from - indexed;
+    unsigned long long end = first.offset + first.size;
+    unsigned long long start = skip == 0 ? first.offset : scanFrames(first.path, first.offset, end,
+        [&skip](unsigned long long) { return --skip != 0; });
+    if (skip != 0)
+    {
+        DO_LOG_LIMITED(logger, "history_t - segment shorter than its index: " + first.path);
+        r_slice.clear();
+        return 0;
+    }
+    first.offset = start;
+    first.size = end - start;
+    return found;
+}
+
+/// <summary>
+/// Метод работы потока писателя
+/// </summary>
+void history_t::writerWork()
+{
+    std::chrono::milliseconds tick(policy == interval ? std::min<unsigned long long>(HISTORY_TICK_MS, fsyncInterval / 1000) : HISTORY_TICK_MS);
+    queue_t batch; // буферы меняются местами с очередью и переиспользуются
+    std::unique_lock<std::mutex> lock(mtx_queue);
+    for (;;)
+    {
+        cv_queue.wait_for(lock, tick, [this]() { return b_stop || queue.data.size() >= HISTORY_WAKE_BYTES || flushRequested != flushDone; });
+        bool b_exit = b_stop;
+        unsigned long long request = flushRequested;
+        bool b_sync = b_exit || syncRequested > flushDone; // flushDone меняет только писатель
+        std::swap(batch, queue);
+        lock.unlock();
+
+        writeBatch(batch, b_sync);
+
+        lock.lock();
+        flushDone = request;
+        cv_flushed.notify_all();
+        if (b_exit)
+            break;
+    }
+    lock.unlock();
+
+    std::lock_guard<std::mutex> lockRooms(mtx_rooms);
+    for (auto& it : m_room)
+        if (it.second->fd >= 0)
+        {
+            closeFile(it.second->fd);
+            closeFile(it.second->idxFd);
+            it.second->fd = it.second->idxFd = -1;
+        }
+}
+
+/// <summary>
+/// Метод записи группы кадров: раскладка по комнатам, запись в сегменты, сброс по политике
+/// </summary>
+/// <param name="batch"> - группа кадров (после записи очищается) </param>
+/// <param name="b_sync"> - сбросить на диск независимо от политики </param>
+void history_t::writeBatch(queue_t& batch, bool b_sync)
+{
+    if (!batch.v_record.empty())
+    {
+        batchSize.Record(batch.v_record.size());
+        std::lock_guard<std::mutex> lock(mtx_rooms);
+        std::string_view prevName;
+        roomLog_t* log = nullptr;
+        for (const queue_t::record_t& record : batch.v_record)
+        {
+            std::string_view name(batch.data.data() + record.offset, record.roomSize);
+            if (log == nullptr || name != prevName) // подряд обычно идут сообщения одной комнаты
+            {
+                log = &openRoom(name);
+                prevName = name;
+            }
+            if (log->v_start.empty())
+                v_dirty.push_back(log);
+            log->v_start.push_back(log->pending.size());
+            log->pending.append(batch.data, record.offset + record.roomSize, record.frameSize);
+        }
+    }
+
+    for (roomLog_t* log : v_dirty)
+        writeRoom(*log);
+    v_dirty.clear();
+    batch.data.clear();
+    batch.v_record.clear();
+
+    if (b_sync || (policy == every && unsyncedCount >= fsyncEvery)
+        || (policy == interval && unsyncedCount != 0 && metrics_t::Now() - lastSync >= fsyncInterval))
+        syncAll();
+}
+
+/// <summary>
+/// Метод записи накопленных кадров комнаты в ее дописываемый сегмент
+/// </summary>
+/// <param name="log"> - журнал комнаты </param>
+void history_t::writeRoom(roomLog_t& log)
+{
+    // сегменты и их размеры меняет только писатель, ему читать их можно без мьютекса
+    segment_t* segment = log.v_segment.empty() ? nullptr : &log.v_segment.back();
+    if (log.fd < 0 || segment->size >= segmentBytes)
+    {
+        if (!openSegment(log, segment == nullptr || segment->size >= segmentBytes))
+        {
+            dropped.Add(log.v_start.size());
+            log.pending.clear();
+            log.v_start.clear();
+            return;
+        }
+        segment = &log.v_segment.back();
+    }
+
+    std::vector<unsigned long long> v_entry; // новые записи индекса парами (номер, смещение)
+    unsigned long long seq = log.next;
+    for (size_t start : log.v_start)
+    {
+        if ((seq - segment->base) % HISTORY_INDEX_EVERY == 0 && segment->index.back().first < seq)
+        {
+            v_entry.push_back(seq);
+            v_entry.push_back(segment->size + start);
+        }
+        ++seq;
+    }
+
+    if (!writeAll(log.fd, log.pending.data(), log.pending.size()))
+    {
+        DO_LOG_LIMITED(logger, "history_t - fail write " + segmentPath(log, segment->base, ".log"), errno);
+        std::error_code ec; // частично записанный хвост убираем, следующая группа откроет сегмент заново
+        std::filesystem::resize_file(segmentPath(log, segment->base, ".log"), segment->size, ec);
+        closeFile(log.fd);
+        closeFile(log.idxFd);
+        log.fd = log.idxFd = -1;
+        dropped.Add(log.v_start.size());
+    }
+    else
+    {
+        // индекс восстановим досчетом сегмента, если его запись не удастся
+        if (!v_entry.empty())
+            writeAll(log.idxFd, reinterpret_cast<const char*>(v_entry.data()), v_entry.size() * sizeof(v_entry[0]));
+        {
+            std::lock_guard<std::mutex> lock(mtx_rooms);
+            segment->size += log.pending.size();
+            for (size_t i = 0; i < v_entry.size(); i += 2)
+                segment->index.emplace_back(v_entry[i], v_entry[i + 1]);
+            log.next = seq;
+        }
+        appended.Add(log.v_start.size());
+        bytes.Add(log.pending.size());
+        unsyncedCount += log.v_start.size();
+        if (!log.b_unsynced)
+        {
+            log.b_unsynced = true;
+            v_unsynced.push_back(&log);
+        }
+    }
+    log.pending.clear();
+    log.v_start.clear();
+}
+
+/// <summary>
+/// Метод открытия дописываемого сегмента комнаты: последнего либо нового с номера next.
+/// Прежний дописываемый сегмент сбрасывается на диск (кроме политики none) и закрывается
+/// </summary>
+/// <param name="log"> - журнал комнаты </param>
+/// <param name="b_new"> - начать новый сегмент </param>
+/// <returns> 1 - сегмент открыт </returns>
+bool history_t::openSegment(roomLog_t& log, bool b_new)
+{
+    if (log.fd >= 0)
+    {
+        if (policy != none && log.b_unsynced && !syncFile(log.fd))
+            DO_LOG_LIMITED(logger, "history_t - fail sync " + log.dir, errno);
+        closeFile(log.fd);
+        closeFile(log.idxFd);
+        log.fd = log.idxFd = -1;
+    }
+
+    unsigned long long base = b_new ? log.next : log.v_segment.back().base;
+    log.fd = openAppend(segmentPath(log, base, ".log"));
+    log.idxFd = openAppend(segmentPath(log, base, ".idx"));
+    if (log.fd < 0 || log.idxFd < 0)
+    {
+        DO_LOG_LIMITED(logger, "history_t - fail open segment " + segmentPath(log, base, ".log"), errno);
+        if (log.fd >= 0)
+            closeFile(log.fd);
+        if (log.idxFd >= 0)
+            closeFile(log.idxFd);
+        log.fd = log.idxFd = -1;
+        return false;
+    }
+
+    if (b_new)
+    {
+        unsigned long long entry[2] = { base, 0 };
+        writeAll(log.idxFd, reinterpret_cast<const char*>(entry), sizeof(entry));
+        std::lock_guard<std::mutex> lock(mtx_rooms);
+        log.v_segment.push_back(segment_t{ base, 0, { { base, 0 } } });
+    }
+    return true;
+}
+
+/// <summary>
+/// Метод сброса на диск всех комнат с несброшенными записями
+/// </summary>
+void history_t::syncAll()
+{
+    if (v_unsynced.empty())
+        return;
+
+    unsigned long long start = metrics_t::Now();
+    for (roomLog_t* log : v_unsynced)
+    {
+        if (log->fd >= 0 && !syncFile(log->fd))
+            DO_LOG_LIMITED(logger, "history_t - fail sync " + log->dir, errno);
+        log->b_unsynced = false;
+    }
+    v_unsynced.clear();
+    unsyncedCount = 0;
+    lastSync = metrics_t::Now();
+    fsyncs.Add();
+    fsyncTime.Record(lastSync - start);
+}
+
+/// <summary>
+/// Метод получения журнала комнаты, при первом обращении он читается с диска (вызывать под mtx_rooms)
+/// </summary>
+/// <param name="room"> - имя комнаты </param>
+/// <returns> журнал комнаты </returns>
+history_t::roomLog_t& history_t::openRoom(std::string_view room)
+{
+    std::string key(room);
+    auto it = m_room.find(key);
+    if (it != m_room.end())
+        return *it->second;
+
+    std::unique_ptr<roomLog_t> log(new roomLog_t{ dir + '/' + roomDir(room), {}, 0, -1, -1, false, {}, {} });
+    std::error_code ec;
+    std::filesystem::create_directories(log->dir, ec);
+    if (ec)
+        DO_LOG_LIMITED(logger, "history_t - fail create dir " + log->dir + ": " + ec.message());
+
+    for (std::filesystem::directory_iterator file(log->dir, ec), end; !ec && file != end; file.increment(ec))
+    {
+        if (file->path().extension() != ".log")
+            continue;
+        std::string stem = file->path().stem().string();
+        unsigned long long base = 0;
+        auto parsed = std::from_chars(stem.data(), stem.data() + stem.size(), base);
+        if (parsed.ec == std::errc() && parsed.ptr == stem.data() + stem.size())
+            log->v_segment.push_back(segment_t{ base, 0, {} });
+    }
+    std::sort(log->v_segment.begin(), log->v_segment.end(),
+        [](const segment_t& a, const segment_t& b) { return a.base < b.base; });
+    for (size_t i = 0; i < log->v_segment.size(); ++i)
+        if (i + 1 == log->v_segment.size())
+            log->next = recoverSegment(*log, log->v_segment[i], true);
+        else
+            recoverSegment(*log, log->v_segment[i], false);
+
+    roomLog_t& result = *log;
+    m_room.emplace(std::move(key), std::move(log));
+    return result;
+}
+
+/// <summary>
+/// Метод восстановления сегмента с диска: чтение индекса, досчет сообщений после последней его записи,
+/// отрезание недописанного кадра
+/// </summary>
+/// <param name="log"> - журнал комнаты </param>
+/// <param name="segment"> - сегмент (base заполнен) </param>
+/// <param name="b_last"> - последний сегмент: досчитываем сообщения до конца </param>
+/// <returns> номер сообщения, следующего за сегментом (для b_last) </returns>
+unsigned long long history_t::recoverSegment(const roomLog_t& log, segment_t& segment, bool b_last)
+{
+    std::string path = segmentPath(log, segment.base, ".log");
+    std::error_code ec;
+    segment.size = std::filesystem::file_size(path, ec);
+    if (ec)
+        segment.size = 0;
+
+    // записи индекса берем, пока они идут по возрастанию и не дальше конца сегмента
+    segment.index.assign(1, std::make_pair(segment.base, 0ull));
+    std::ifstream idxFile(segmentPath(log, segment.base, ".idx").c_str(), std::ios::binary);
+    unsigned long long entry[2];
+    while (idxFile.read(reinterpret_cast<char*>(entry), sizeof(entry)))
+        if (entry[0] > segment.index.back().first && entry[1] > segment.index.back().second && entry[1] <= segment.size)
+            segment.index.emplace_back(entry[0], entry[1]);
+        else if (entry[0] != segment.base || entry[1] != 0)
+            break;
+    if (!b_last)
+        return 0;
+
+    // досчитываем кадры после последней записи индекса
+    size_t indexed = segment.index.size();
+    unsigned long long seq = segment.index.back().first;
+    unsigned long long end = scanFrames(path, segment.index.back().second, segment.size, [&segment, &seq](unsigned long long end)
+        {
+            if ((++seq - segment.base) % HISTORY_INDEX_EVERY == 0)
+                segment.index.emplace_back(seq, end);
+            return true;
+        });
+
+    bool b_cut = end < segment.size;
+    if (b_cut)
+    {
+        std::filesystem::resize_file(path, end, ec);
+        logger.doLog("history_t - cut " + std::to_string(segment.size - end) + " bytes of unfinished frame in " + path);
+        segment.size = end;
+    }
+    if (b_cut || segment.index.size() != indexed)
+    { // переписываем индекс целиком, чтобы следующее восстановление не считало заново
+        std::ofstream idxOut(segmentPath(log, segment.base, ".idx").c_str(), std::ios::binary | std::ios::trunc);
+        for (const auto& it : segment.index)
+        {
+            entry[0] = it.first;
+            entry[1] = it.second;
+            idxOut.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+        }
+    }
+    return seq;
+}
+
+/// <summary>
+/// Метод получения пути файла сегмента
+/// </summary>
+/// <param name="log"> - журнал комнаты </param>
+/// <param name="base"> - номер первого сообщения сегмента </param>
+/// <param name="ext"> - расширение: ".log" или ".idx" </param>
+/// <returns> путь </returns>
+std::string history_t::segmentPath(const roomLog_t& log, unsigned long long base, const char* ext)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu", base); // нули впереди - сегменты по порядку и в листинге каталога
+    return log.dir + '/' + name + ext;
+}
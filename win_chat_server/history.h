@@ -0,0 +1,250 @@
+﻿#pragma once
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "log.h"
+#include "metrics.h"
+
+#define HISTORY_INDEX_EVERY 128 // шаг разреженного индекса: запись (номер, смещение) на каждое N-ое сообщение сегмента
+#define HISTORY_QUEUE_LIMIT (32 << 20) // байт в очереди писателя, сверх этого сообщения не сохраняются
+#define HISTORY_TICK_MS 10 // период писателя, мс: группа набирается за это время без пробуждений из рассылки
+#define HISTORY_WAKE_BYTES (1 << 20) // байт в очереди, при которых рассылка будит писателя досрочно
+#define HISTORY_SCAN_CHUNK 65536 // чтение сегмента при восстановлении, байт
+
+/// <summary>
+/// Журнал истории сообщений комнат на диске. У каждой комнаты свой каталог с сегментами "<номер первого сообщения>.log",
+/// сегмент - кадры сообщений подряд в том же виде, что уходят в сокет. Рядом с сегментом "<номер>.idx" -
+/// разреженный индекс пар (номер сообщения, смещение в сегменте).
+/// Рассылка только копирует кадр в очередь (системный вызов - лишь при HISTORY_WAKE_BYTES в очереди);
+/// пишет, делит на сегменты и сбрасывает на диск отдельный поток раз в HISTORY_TICK_MS
+/// группами (group commit), по политике: none - сброс оставлен ОС, interval - раз в fsyncMs, every - после каждых
+/// fsyncEvery сообщений. При открытии комнаты недописанный хвост последнего сегмента (падение процесса) отрезается.
+/// Каталог журнала принадлежит одному процессу
+/// </summary>
+class history_t
+{
+public:
+    /// <summary>
+    /// политика сброса журнала на диск
+    /// </summary>
+    enum policy_t
+    {
+        none, // сброс оставлен ОС
+        interval, // раз в заданный интервал
+        every // после каждых N сообщений
+    };
+
+    /// <summary>
+    /// кусок файла сегмента
+    /// </summary>
+    struct slice_t
+    {
+        std::string path; // путь файла сегмента
+        unsigned long long offset; // начало куска
+        unsigned long long size; // длина куска
+    };
+
+    /// <summary>
+    /// Конструктор: журнал выключен до Open()
+    /// </summary>
+    /// <param name="logger"> - ссылка на обект логгирования </param>
+    /// <param name="metrics"> - ссылка на реестр метрик </param>
+    history_t(log_t& logger, metrics_t& metrics);
+
+    history_t(const history_t&) = delete;
+    history_t& operator=(const history_t&) = delete;
+
+    /// <summary>
+    /// Деструктор: дописывает очередь, сбрасывает журнал на диск и останавливает писателя
+    /// </summary>
+    ~history_t();
+
+    /// <summary>
+    /// Метод поиска политики сброса по имени
+    /// </summary>
+    /// <param name="name"> - имя политики: none, interval, every </param>
+    /// <param name="r_policy"> - найденная политика </param>
+    /// <returns> 1 - политика найдена </returns>
+    static bool FindPolicy(std::string_view name, policy_t& r_policy);
+
+    /// <summary>
+    /// Метод открытия журнала и запуска писателя
+    /// </summary>
+    /// <param name="dir"> - каталог журнала (пусто - журнал выключен) </param>
+    /// <param name="policy"> - политика сброса на диск </param>
+    /// <param name="fsyncMs"> - интервал сброса для interval, мс </param>
+    /// <param name="fsyncEvery"> - сообщений между сбросами для every </param>
+    /// <param name="segmentBytes"> - размер сегмента, после которого начинается следующий (превышается на одну группу) </param>
+    /// <returns> 1 - журнал включен </returns>
+    bool Open(const std::string& dir, policy_t policy, unsigned fsyncMs, unsigned fsyncEvery, unsigned long long segmentBytes);
+
+    /// <summary>
+    /// Метод постановки кадра сообщения в очередь журнала: не ждет диска, при переполненной очереди кадр теряется
+    /// </summary>
+    /// <param name="room"> - имя комнаты </param>
+    /// <param name="frame"> - кадр сообщения, как он ушел собеседникам </param>
+    /// <returns> 1 - кадр поставлен в очередь </returns>
+    bool Append(std::string_view room, std::string_view frame);
+
+    /// <summary>
+    /// Метод ожидания записи всего, что поставлено в очередь до вызова
+    /// </summary>
+    /// <param name="b_sync"> - дождаться и сброса на диск </param>
+    void Flush(bool b_sync = true);
+
+    /// <summary>
+    /// Метод поиска последних сообщений комнаты в журнале. Куски идут по порядку сегментов, их содержимое - готовые кадры:
+    /// их можно отдавать в сокет как есть. Видно то, что писатель уже записал (см. Flush)
+    /// </summary>
+    /// <param name="room"> - имя комнаты </param>
+    /// <param name="count"> - сколько последних сообщений нужно </param>
+    /// <param name="r_slice"> - куски файлов сегментов с этими сообщениями </param>
+    /// <returns> найдено сообщений (меньше count, если журнал короче) </returns>
+    size_t Last(std::string_view room, size_t count, std::vector<slice_t>& r_slice);
+protected:
+    /// <summary>
+    /// сегмент журнала комнаты (поля - под mtx_rooms)
+    /// </summary>
+    struct segment_t
+    {
+        unsigned long long base; // номер первого сообщения сегмента
+        unsigned long long size; // записано байт
+        std::vector<std::pair<unsigned long long, unsigned long long>> index; // разреженный индекс (номер, смещение)
+    };
+
+    /// <summary>
+    /// журнал одной комнаты
+    /// </summary>
+    struct roomLog_t
+    {
+        std::string dir; // каталог комнаты
+        std::vector<segment_t> v_segment; // сегменты по возрастанию номеров (под mtx_rooms)
+        unsigned long long next; // номер следующего сообщения (под mtx_rooms)
+
+        // дальше - только поток писателя
+        int fd; // дескриптор дописываемого сегмента (-1 - не открыт)
+        int idxFd; // дескриптор индекса дописываемого сегмента
+        bool b_unsynced; // есть записи после последнего сброса
+        std::string pending; // кадры текущей группы
+        std::vector<size_t> v_start; // начала кадров текущей группы в pending
+    };
+
+    /// <summary>
+    /// очередь писателя: кадры подряд в одном буфере, без выделения памяти на каждое сообщение
+    /// </summary>
+    struct queue_t
+    {
+        struct record_t
+        {
+            size_t offset; // начало имени комнаты в data, за ним кадр
+            size_t roomSize; // длина имени комнаты
+            size_t frameSize; // длина кадра
+        };
+
+        std::string data; // имена комнат и кадры
+        std::vector<record_t> v_record; // записи по порядку поступления
+    };
+
+    /// <summary>
+    /// Метод работы потока писателя
+    /// </summary>
+    void writerWork();
+
+    /// <summary>
+    /// Метод записи группы кадров: раскладка по комнатам, запись в сегменты, сброс по политике
+    /// </summary>
+    /// <param name="batch"> - группа кадров (после записи очищается) </param>
+    /// <param name="b_sync"> - сбросить на диск независимо от политики </param>
+    void writeBatch(queue_t& batch, bool b_sync);
+
+    /// <summary>
+    /// Метод записи накопленных кадров комнаты в ее дописываемый сегмент
+    /// </summary>
+    /// <param name="log"> - журнал комнаты </param>
+    void writeRoom(roomLog_t& log);
+
+    /// <summary>
+    /// Метод открытия дописываемого сегмента комнаты: последнего либо нового с номера next.
+    /// Прежний дописываемый сегмент сбрасывается на диск (кроме политики none) и закрывается
+    /// </summary>
+    /// <param name="log"> - журнал комнаты </param>
+    /// <param name="b_new"> - начать новый сегмент </param>
+    /// <returns> 1 - сегмент открыт </returns>
+    bool openSegment(roomLog_t& log, bool b_new);
+
+    /// <summary>
+    /// Метод сброса на диск всех комнат с несброшенными записями
+    /// </summary>
+    void syncAll();
+
+    /// <summary>
+    /// Метод получения журнала комнаты, при первом обращении он читается с диска (вызывать под mtx_rooms)
+    /// </summary>
+    /// <param name="room"> - имя комнаты </param>
+    /// <returns> журнал комнаты </returns>
+    roomLog_t& openRoom(std::string_view room);
+
+    /// <summary>
+    /// Метод восстановления сегмента с диска: чтение индекса, досчет сообщений после последней его записи,
+    /// отрезание недописанного кадра
+    /// </summary>
+    /// <param name="log"> - журнал комнаты </param>
+    /// <param name="segment"> - сегмент (base заполнен) </param>
+    /// <param name="b_last"> - последний сегмент: досчитываем сообщения до конца </param>
+    /// <returns> номер сообщения, следующего за сегментом (для b_last) </returns>
+    unsigned long long recoverSegment(const roomLog_t& log, segment_t& segment, bool b_last);
+
+    /// <summary>
+    /// Метод получения пути файла сегмента
+    /// </summary>
+    /// <param name="log"> - журнал комнаты </param>
+    /// <param name="base"> - номер первого сообщения сегмента </param>
+    /// <param name="ext"> - расширение: ".log" или ".idx" </param>
+    /// <returns> путь </returns>
+    static std::string segmentPath(const roomLog_t& log, unsigned long long base, const char* ext);
+
+    log_t& logger; // ссылка на обект логгирования
+    std::string dir; // каталог журнала
+    policy_t policy; // политика сброса
+    unsigned long long fsyncInterval; // интервал сброса, мкс
+    unsigned fsyncEvery; // сообщений между сбросами
+    unsigned long long segmentBytes; // размер сегмента
+
+    std::mutex mtx_queue; // мьютекс очереди
+    std::condition_variable cv_queue; // пробуждение писателя
+    std::condition_variable cv_flushed; // окончание запрошенного сброса
+    queue_t queue; // очередь писателя (под mtx_queue)
+    unsigned long long flushRequested; // номер последнего запроса Flush() (под mtx_queue)
+    unsigned long long syncRequested; // номер последнего запроса Flush() со сбросом на диск (под mtx_queue)
+    unsigned long long flushDone; // номер последнего выполненного запроса (под mtx_queue)
+    bool b_stop; // писатель дописывает очередь и выходит (под mtx_queue)
+    bool b_open; // журнал включен (меняется только в Open())
+
+    std::mutex mtx_rooms; // мьютекс журналов комнат
+    std::unordered_map<std::string, std::unique_ptr<roomLog_t>> m_room; // журналы комнат по имени (под mtx_rooms)
+
+    std::vector<roomLog_t*> v_dirty; // комнаты текущей группы (только писатель)
+    std::vector<roomLog_t*> v_unsynced; // комнаты с записями после последнего сброса (только писатель)
+    unsigned long long lastSync; // время последнего сброса, мкс (только писатель)
+    unsigned long long unsyncedCount; // сообщений после последнего сброса (только писатель)
+
+    counter_t& appended; // метрика: сообщений записано в журнал
+    counter_t& dropped; // метрика: сообщений потеряно при переполненной очереди
+    counter_t& bytes; // метрика: байт записано в журнал
+    counter_t& fsyncs; // метрика: сбросов на диск
+    histogram_t& fsyncTime; // метрика: длительность сброса группы, мкс
+    histogram_t& batchSize; // метрика: сообщений в группе писателя
+
+    std::thread writer; // поток писателя
+};
+
+#endif /* HISTORY_H_ */
@@ -7,7 +7,7 @@
 ///   
 ///      ,    
 /// </summary>
-log_t::log_t() : consoleActive(true), lastErr(0)
+log_t::log_t() : consoleActive(true), lastErr(0), limitBurst(5), limitPeriodMs(1000)
 {
     time_zone = 3; // TO_DO
 }
@@ -16,7 +16,7 @@ log_t::log_t() : consoleActive(true), lastErr(0)
 /// </summary>
 /// <param name="nameLogFile"> -    </param>
 /// <param name="consoleActive"> -      </param>
-log_t::log_t(std::string nameLogFile, bool consoleActive) : consoleActive(consoleActive), lastErr(0)
+log_t::log_t(std::string nameLogFile, bool consoleActive) : consoleActive(consoleActive), lastErr(0), limitBurst(5), limitPeriodMs(1000)
 {
     time_zone = 3; // TO_DO
     logFile.open(nameLogFile.c_str(), std::ios::app); //     
@@ -43,6 +43,7 @@ void log_t::doLog(std::string log, int errCode)
     std::string msg = getTime();
     msg.append(" :: "); 
     msg.append(log);
+    std::lock_guard<std::mutex> lock(mtx_write);
     //    ,  
     if (errCode != 0x80000000)
     {
@@ -59,6 +60,110 @@ void log_t::doLog(std::string log, int errCode)
         logFile.flush();
     }
 }
+
+/// <summary>
+///       ,   DO_LOG_LIMITED.
+///         ,     
+/// </summary>
+/// <param name="site"> -    </param>
+/// <returns> 1 -   , 0 -   </returns>
+bool log_t::checkSite(site_t& site)
+{
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    unsigned reportLogged = 0, reportTotal = 0;
+    bool b_pass = true, b_list = false;
+    {
+        std::lock_guard<std::mutex> lock(site.mutex);
+        rollSite(site, now, reportLogged, reportTotal);
+
+        ++site.total;
+        if (site.logged >= limitBurst)
+        { //   ,  
+            b_pass = false;
+            b_list = !site.b_listed; //   FlushLimited(),     
+            site.b_listed = true;
+        }
+        else
+            ++site.logged;
+    }
+
+    if (reportTotal > 0)
+        logSummary(site, reportLogged, reportTotal);
+    if (b_list)
+    {
+        std::lock_guard<std::mutex> lock(mtx_sites);
+        v_sites.push_back(&site);
+    }
+    return b_pass;
+}
+
+/// <summary>
+///        ,    .
+///   (,    )
+/// </summary>
+void log_t::FlushLimited()
+{
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    std::lock_guard<std::mutex> lock(mtx_sites);
+    for (site_t* site : v_sites)
+    {
+        unsigned reportLogged = 0, reportTotal = 0;
+        {
+            std::lock_guard<std::mutex> lockSite(site->mutex);
+            rollSite(*site, now, reportLogged, reportTotal);
+        }
+        if (reportTotal > 0)
+            logSummary(*site, reportLogged, reportTotal);
+    }
+}
+
+/// <summary>
+///       (  )
+/// </summary>
+/// <param name="site"> -    </param>
+/// <param name="now"> -  ,  </param>
+/// <param name="logged"> -     ,      </param>
+/// <param name="total"> -     ,      ( 0) </param>
+/// <returns> 1 -   </returns>
+bool log_t::rollSite(site_t& site, long long now, unsigned& logged, unsigned& total)
+{
+    if (now - site.windowStart < limitPeriodMs)
+        return false;
+
+    if (site.total > site.logged)
+    {
+        logged = site.logged;
+        total = site.total;
+    }
+    site.windowStart = now;
+    site.logged = 0;
+    site.total = 0;
+    return true;
+}
+
+/// <summary>
+///        
+/// </summary>
+/// <param name="site"> -    </param>
+/// <param name="logged"> -     </param>
+/// <param name="total"> -     </param>
+void log_t::logSummary(const site_t& site, unsigned logged, unsigned total)
+{
+    doLog(std::string("logged ") + std::to_string(logged) + " of " + std::to_string(total) + " similar at " + site.file + ':'
+        + std::to_string(site.line) + " in last " + std::to_string(limitPeriodMs) + " ms");
+}
+
+/// <summary>
+///      DO_LOG_LIMITED
+/// </summary>
+/// <param name="burst"> -          </param>
+/// <param name="periodMs"> -  ,  </param>
+void log_t::SetRateLimit(unsigned burst, unsigned periodMs)
+{
+    limitBurst = burst;
+    limitPeriodMs = periodMs;
+}
+
 #ifdef DEBUG
 /// <summary>
 ///         
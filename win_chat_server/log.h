@@ -5,6 +5,8 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <mutex>
+#include <vector>
 
 #ifdef DEBUG
 #define DEBUG_TRACE(logger, string) logger.doDebugTrace(string)
@@ -12,16 +14,40 @@
 #define DEBUG_TRACE(logger, string)
 #endif
 
+//        (     ),
+//      ,     checkSite()  FlushLimited()
+#define DO_LOG_LIMITED(logger, ...) \
+    do { static log_t::site_t logSite(__FILE__, __LINE__); if ((logger).checkSite(logSite)) (logger).doLog(__VA_ARGS__); } while (0)
+
 /// <summary>
 ///       / 
 /// </summary>
 class log_t
 {
 public:
+    /// <summary>
+    ///        DO_LOG_LIMITED
+    /// </summary>
+    struct site_t
+    {
+        site_t(const char* file, int line) : file(file), line(line), windowStart(0), logged(0), total(0), b_listed(false)
+        {}
+        const char* file; //   -  
+        int line;
+        std::mutex mutex; //  
+        long long windowStart; //   , 
+        unsigned logged; //     
+        unsigned total; //     
+        bool b_listed; //       FlushLimited()
+    };
+
     log_t();
     log_t(std::string nameLogFile, bool consoleActive);
     std::string getTime();
     void doLog(std::string log, int errCode = 0x80000000);
+    bool checkSite(site_t& site);
+    void FlushLimited();
+    void SetRateLimit(unsigned burst, unsigned periodMs);
 #ifdef DEBUG
     void doDebugTrace(std::string trace);
 #endif
@@ -32,6 +58,14 @@ protected:
     bool consoleActive; //    
     int time_zone; //  
     int lastErr; //   
+    std::mutex mtx_write; //     
+    unsigned limitBurst; //         
+    unsigned limitPeriodMs; //    , 
+    std::mutex mtx_sites; //      
+    std::vector<site_t*> v_sites; //  ,    (  )
+
+    bool rollSite(site_t& site, long long now, unsigned& logged, unsigned& total);
+    void logSummary(const site_t& site, unsigned logged, unsigned total);
 };
 
 #endif // !LOG_T
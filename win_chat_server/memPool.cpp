@@ -0,0 +1,172 @@
+﻿#include "memPool.h"
+#include <new>
+
+/// <summary>
+/// Конструктор
+/// </summary>
+memPool_t::memPool_t() : oversize(0)
+{
+    for (auto& sizeClass : classes)
+    {
+        sizeClass.free = nullptr;
+        sizeClass.blocks = 0;
+        sizeClass.hits = 0;
+        sizeClass.misses = 0;
+        sizeClass.inUse = 0;
+    }
+}
+
+/// <summary>
+/// Деструктор: возвращает все slab в кучу. Блоки, выданные пулом, к этому моменту должны быть возвращены
+/// </summary>
+memPool_t::~memPool_t()
+{
+    for (auto& sizeClass : classes)
+        for (void* slab : sizeClass.v_slab)
+            ::operator delete(slab);
+}
+
+/// <summary>
+/// Метод получения класса размера
+/// </summary>
+/// <param name="size"> - размер, байт </param>
+/// <returns> индекс класса, MEMPOOL_CLASSES - блок крупнее максимального </returns>
+size_t memPool_t::classIndex(size_t size)
+{
+    if (size <= (size_t(1) << MEMPOOL_MIN_SHIFT))
+        return 0;
+    if (size > (size_t(1) << MEMPOOL_MAX_SHIFT))
+        return MEMPOOL_CLASSES;
+
+    size_t index = 0; // номер старшего бита (size - 1) дает степень двойки, вмещающую size
+    for (size_t rest = (size - 1) >> MEMPOOL_MIN_SHIFT; rest != 0; rest >>= 1)
+        ++index;
+    return index;
+}
+
+/// <summary>
+/// Метод нарезки нового slab в список свободных блоков класса (вызывать под блокировкой класса)
+/// </summary>
+/// <param name="index"> - индекс класса </param>
+void memPool_t::cutSlab(size_t index)
+{
+    class_t& sizeClass = classes[index];
+    const size_t block = size_t(1) << (MEMPOOL_MIN_SHIFT + index);
+    const size_t count = MEMPOOL_SLAB_SIZE > block ? MEMPOOL_SLAB_SIZE / block : 1;
+    char* slab = static_cast<char*>(::operator new(block * count));
+    sizeClass.v_slab.push_back(slab);
+    for (size_t i = count; i > 0; --i)
+    {
+        block_t* free = reinterpret_cast<block_t*>(slab + (i - 1) * block);
+        free->next = sizeClass.free;
+        sizeClass.free = free;
+    }
+    sizeClass.blocks += count;
+}
+
+/// <summary>
+/// Метод выделения блока
+/// </summary>
+/// <param name="size"> - требуемый размер, байт </param>
+/// <returns> указатель на блок (выравнивание не хуже, чем у operator new) </returns>
+void* memPool_t::Allocate(size_t size)
+{
+    size_t index = classIndex(size);
+    if (index == MEMPOOL_CLASSES)
+    {
+        oversize.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    class_t& sizeClass = classes[index];
+    spinLock_t lock(sizeClass.lock);
+    if (sizeClass.free == nullptr)
+    { // свободных блоков нет - режем новый slab
+        cutSlab(index);
+        ++sizeClass.misses;
+    }
+    else
+        ++sizeClass.hits;
+
+    block_t* result = sizeClass.free;
+    sizeClass.free = result->next;
+    ++sizeClass.inUse;
+    return result;
+}
+
+/// <summary>
+/// Метод возврата блока в пул
+/// </summary>
+/// <param name="ptr"> - указатель на блок </param>
+/// <param name="size"> - размер, с которым блок выделялся </param>
+void memPool_t::Free(void* ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+
+    size_t index = classIndex(size);
+    if (index == MEMPOOL_CLASSES)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    class_t& sizeClass = classes[index];
+    spinLock_t lock(sizeClass.lock);
+    block_t* block = static_cast<block_t*>(ptr);
+    block->next = sizeClass.free;
+    sizeClass.free = block;
+    --sizeClass.inUse;
+}
+
+/// <summary>
+/// Метод предварительного выделения: нарезает slab, пока в классе размера не наберется count свободных блоков
+/// </summary>
+/// <param name="size"> - размер блока, байт </param>
+/// <param name="count"> - количество блоков </param>
+void memPool_t::Reserve(size_t size, size_t count)
+{
+    size_t index = classIndex(size);
+    if (index == MEMPOOL_CLASSES)
+        return; // крупные блоки идут напрямую из кучи
+
+    class_t& sizeClass = classes[index];
+    spinLock_t lock(sizeClass.lock);
+    while (sizeClass.blocks - sizeClass.inUse < count)
+        cutSlab(index);
+}
+
+/// <summary>
+/// Метод вывода статистики пула в текстовом виде "имя.класс hit=.. miss=.. in_use=.. hit_rate=.."
+/// </summary>
+/// <param name="buf"> - буфер для вывода </param>
+/// <param name="name"> - имя пула в выводе </param>
+void memPool_t::Print(std::string& buf, const std::string& name) const
+{
+    for (size_t index = 0; index < MEMPOOL_CLASSES; ++index)
+    {
+        class_t& sizeClass = classes[index];
+        spinLock_t lock(sizeClass.lock);
+        unsigned long long total = sizeClass.hits + sizeClass.misses;
+        if (total == 0)
+            continue; // класс еще не использовался
+
+        buf += name + '.' + std::to_string(size_t(1) << (MEMPOOL_MIN_SHIFT + index))
+            + " hit=" + std::to_string(sizeClass.hits) + " miss=" + std::to_string(sizeClass.misses)
+            + " in_use=" + std::to_string(sizeClass.inUse)
+            + " slab=" + std::to_string(sizeClass.v_slab.size())
+            + " hit_rate=" + std::to_string(static_cast<double>(sizeClass.hits) / total) + '\n';
+    }
+    buf += name + ".oversize " + std::to_string(oversize.load(std::memory_order_relaxed)) + '\n';
+}
+
+/// <summary>
+/// Метод получения общего пула процесса (буферы сокетов и кадров)
+/// </summary>
+/// <returns> ссылка на общий пул </returns>
+memPool_t& memPool_t::Global()
+{
+    // пул намеренно не разрушается: буферы статических объектов могут пережить статический пул
+    static memPool_t* global = new memPool_t();
+    return *global;
+}
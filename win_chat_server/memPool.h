@@ -0,0 +1,171 @@
+﻿#pragma once
+#ifndef MEMPOOL_H_
+#define MEMPOOL_H_
+
+#include <string>
+#include <vector>
+#include <thread>
+
+#include <atomic>
+#include <cstddef>
+
+#define MEMPOOL_MIN_SHIFT 5 // минимальный блок 2^5 = 32 байта
+#define MEMPOOL_MAX_SHIFT 16 // максимальный блок 2^16 = 64 КиБ, крупнее - напрямую из кучи
+#define MEMPOOL_CLASSES (MEMPOOL_MAX_SHIFT - MEMPOOL_MIN_SHIFT + 1) // количество классов размера
+#define MEMPOOL_SLAB_SIZE (256 * 1024) // размер slab, нарезаемого на блоки одного класса
+
+/// <summary>
+/// Пул памяти с классами размера (степени двойки от 32 байт до 64 КиБ).
+/// Каждый класс режет крупные slab на блоки и держит освобожденные блоки в списке,
+/// память в кучу не возвращается до разрушения пула - в установившемся режиме malloc/free не вызываются
+/// </summary>
+class memPool_t
+{
+public:
+    memPool_t();
+    ~memPool_t();
+
+    memPool_t(const memPool_t&) = delete;
+    memPool_t& operator=(const memPool_t&) = delete;
+
+    /// <summary>
+    /// Метод выделения блока
+    /// </summary>
+    /// <param name="size"> - требуемый размер, байт </param>
+    /// <returns> указатель на блок (выравнивание не хуже, чем у operator new) </returns>
+    void* Allocate(size_t size);
+
+    /// <summary>
+    /// Метод возврата блока в пул
+    /// </summary>
+    /// <param name="ptr"> - указатель на блок </param>
+    /// <param name="size"> - размер, с которым блок выделялся </param>
+    void Free(void* ptr, size_t size);
+
+    /// <summary>
+    /// Метод предварительного выделения: нарезает slab, пока в классе размера не наберется count свободных блоков
+    /// </summary>
+    /// <param name="size"> - размер блока, байт </param>
+    /// <param name="count"> - количество блоков </param>
+    void Reserve(size_t size, size_t count);
+
+    /// <summary>
+    /// Метод вывода статистики пула в текстовом виде "имя.класс hit=.. miss=.. in_use=.. hit_rate=.."
+    /// </summary>
+    /// <param name="buf"> - буфер для вывода </param>
+    /// <param name="name"> - имя пула в выводе </param>
+    void Print(std::string& buf, const std::string& name) const;
+
+    /// <summary>
+    /// Метод получения общего пула процесса (буферы сокетов и кадров)
+    /// </summary>
+    /// <returns> ссылка на общий пул </returns>
+    static memPool_t& Global();
+protected:
+    /// <summary>
+    /// Метод получения класса размера
+    /// </summary>
+    /// <param name="size"> - размер, байт </param>
+    /// <returns> индекс класса, MEMPOOL_CLASSES - блок крупнее максимального </returns>
+    static size_t classIndex(size_t size);
+
+    /// <summary>
+    /// Метод нарезки нового slab в список свободных блоков класса (вызывать под блокировкой класса)
+    /// </summary>
+    /// <param name="index"> - индекс класса </param>
+    void cutSlab(size_t index);
+
+    struct block_t // свободный блок хранит ссылку на следующий свободный
+    {
+        block_t* next;
+    };
+
+    /// <summary>
+    /// спин-блокировка класса размера: критическая секция - несколько присваиваний, засыпать на мьютексе дороже
+    /// </summary>
+    class spinLock_t
+    {
+    public:
+        spinLock_t(std::atomic_flag& flag) : flag(flag)
+        {
+            while (flag.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        ~spinLock_t()
+        {
+            flag.clear(std::memory_order_release);
+        }
+    private:
+        std::atomic_flag& flag;
+    };
+
+    struct class_t // класс размера: своя блокировка, свободные блоки и нарезанные slab
+    {
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        block_t* free; // список свободных блоков
+        unsigned long long blocks; // нарезано блоков всего
+        std::vector<void*> v_slab; // выделенные slab (освобождаются в деструкторе пула)
+        unsigned long long hits; // выдано из списка свободных
+        unsigned long long misses; // пришлось выделить новый slab
+        unsigned long long inUse; // выдано и еще не возвращено
+    };
+
+    mutable class_t classes[MEMPOOL_CLASSES]; // классы размера
+    std::atomic<unsigned long long> oversize; // выделений крупнее MEMPOOL_MAX_SHIFT (идут в кучу)
+};
+
+/// <summary>
+/// Аллокатор STL поверх memPool_t. По умолчанию берет общий пул процесса
+/// </summary>
+template<class T>
+class poolAllocator_t
+{
+public:
+    typedef T value_type;
+
+    poolAllocator_t() noexcept : pool(&memPool_t::Global())
+    {}
+
+    /// <summary>
+    /// конструктор
+    /// </summary>
+    /// <param name="pool"> -- пул, из которого выделяется память </param>
+    explicit poolAllocator_t(memPool_t& pool) noexcept : pool(&pool)
+    {}
+
+    template<class U>
+    poolAllocator_t(const poolAllocator_t<U>& other) noexcept : pool(other.pool)
+    {}
+
+    T* allocate(size_t count)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "memPool_t does not provide extended alignment");
+        return static_cast<T*>(pool->Allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t count) noexcept
+    {
+        pool->Free(ptr, count * sizeof(T));
+    }
+
+    template<class U>
+    bool operator==(const poolAllocator_t<U>& other) const noexcept
+    {
+        return pool == other.pool;
+    }
+
+    template<class U>
+    bool operator!=(const poolAllocator_t<U>& other) const noexcept
+    {
+        return pool != other.pool;
+    }
+private:
+    template<class U> friend class poolAllocator_t;
+
+    memPool_t* pool; // пул, из которого выделяется память
+};
+
+typedef std::basic_string<char, std::char_traits<char>, poolAllocator_t<char>> poolString_t; // строка в общем пуле
+
+#endif /* MEMPOOL_H_ */
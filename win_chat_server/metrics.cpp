@@ -0,0 +1,225 @@
+﻿#include "metrics.h"
+
+/// <summary>
+/// Конструктор
+/// </summary>
+counter_t::counter_t()
+{
+    for (size_t index = 0; index < METRICS_SHARDS; ++index)
+        shards[index].value = 0;
+}
+
+/// <summary>
+/// Метод получения индекса шарда текущего потока
+/// </summary>
+/// <returns> индекс шарда </returns>
+size_t counter_t::shardIndex()
+{
+    static std::atomic<size_t> nextIndex(0); // раздаем шарды потокам по кругу
+    thread_local size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed) & (METRICS_SHARDS - 1);
+    return index;
+}
+
+/// <summary>
+/// Метод увеличения счетчика
+/// </summary>
+/// <param name="value"> - приращение </param>
+void counter_t::Add(unsigned long long value)
+{
+    shards[shardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Метод получения значения счетчика (сумма по шардам)
+/// </summary>
+/// <returns> значение счетчика </returns>
+unsigned long long counter_t::Get() const
+{
+    unsigned long long result = 0;
+    for (size_t index = 0; index < METRICS_SHARDS; ++index)
+        result += shards[index].value.load(std::memory_order_relaxed);
+    return result;
+}
+
+/// <summary>
+/// Конструктор
+/// </summary>
+histogram_t::histogram_t() : sum(0), max(0)
+{
+    for (size_t index = 0; index < BUCKETS; ++index)
+        buckets[index] = 0;
+}
+
+/// <summary>
+/// Метод вычисления индекса корзины по значению
+/// </summary>
+/// <param name="value"> - значение </param>
+/// <returns> индекс корзины </returns>
+size_t histogram_t::bucketIndex(unsigned long long value)
+{
+    if (value < SUB_COUNT) // первые корзины линейные
+        return static_cast<size_t>(value);
+
+    if (value >> HISTOGRAM_MAX_BITS) // за пределами диапазона - в последнюю корзину
+        return BUCKETS - 1;
+
+    size_t msb = HISTOGRAM_SUB_BITS; // номер старшего бита
+    while (value >> (msb + 1))
+        ++msb;
+
+    size_t shift = msb - HISTOGRAM_SUB_BITS; // сколько младших бит отбрасываем
+    size_t top = static_cast<size_t>(value >> shift); // старшие биты значения [SUB_COUNT, 2*SUB_COUNT)
+    return (shift + 1) * SUB_COUNT + (top - SUB_COUNT);
+}
+
+/// <summary>
+/// Метод вычисления верхней границы корзины
+/// </summary>
+/// <param name="index"> - индекс корзины </param>
+/// <returns> верхняя граница значений корзины </returns>
+unsigned long long histogram_t::bucketValue(size_t index)
+{
+    if (index < SUB_COUNT)
+        return index;
+
+    size_t shift = index / SUB_COUNT - 1;
+    unsigned long long top = SUB_COUNT + index % SUB_COUNT;
+    return ((top + 1) << shift) - 1;
+}
+
+/// <summary>
+/// Метод записи значения
+/// </summary>
+/// <param name="value"> - значение (обычно микросекунды) </param>
+void histogram_t::Record(unsigned long long value)
+{
+    buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    unsigned long long current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {}
+}
+
+/// <summary>
+/// Метод получения количества записанных значений
+/// </summary>
+/// <returns> количество значений </returns>
+unsigned long long histogram_t::Count() const
+{
+    unsigned long long result = 0;
+    for (size_t index = 0; index < BUCKETS; ++index)
+        result += buckets[index].load(std::memory_order_relaxed);
+    return result;
+}
+
+/// <summary>
+/// Метод получения перцентиля
+/// </summary>
+/// <param name="percent"> - перцентиль (0..100) </param>
+/// <returns> верхняя граница корзины, в которую попал перцентиль </returns>
+unsigned long long histogram_t::Percentile(double percent) const
+{
+    unsigned long long total = Count();
+    if (total == 0)
+        return 0;
+
+    unsigned long long rank = static_cast<unsigned long long>(percent / 100.0 * total + 0.5); // номер искомого значения
+    if (rank == 0) rank = 1;
+    if (rank > total) rank = total;
+
+    unsigned long long accum = 0;
+    for (size_t index = 0; index < BUCKETS; ++index)
+    {
+        accum += buckets[index].load(std::memory_order_relaxed);
+        if (accum >= rank) // не выдаем больше реального максимума
+            return bucketValue(index) < Max() ? bucketValue(index) : Max();
+    }
+
+    return Max();
+}
+
+/// <summary>
+/// Метод получения среднего значения
+/// </summary>
+/// <returns> среднее значение </returns>
+unsigned long long histogram_t::Mean() const
+{
+    unsigned long long total = Count();
+    return total ? sum.load(std::memory_order_relaxed) / total : 0;
+}
+
+/// <summary>
+/// Метод получения максимального значения
+/// </summary>
+/// <returns> максимальное значение </returns>
+unsigned long long histogram_t::Max() const
+{
+    return max.load(std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Метод получения (регистрации) счетчика
+/// </summary>
+/// <param name="name"> - имя метрики </param>
+/// <returns> ссылка на счетчик, валидна все время жизни реестра </returns>
+counter_t& metrics_t::Counter(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<counter_t>& ptr = m_counter[name];
+    if (!ptr)
+        ptr.reset(new counter_t);
+    return *ptr;
+}
+
+/// <summary>
+/// Метод получения (регистрации) мгновенного значения
+/// </summary>
+/// <param name="name"> - имя метрики </param>
+/// <returns> ссылка на значение, валидна все время жизни реестра </returns>
+gauge_t& metrics_t::Gauge(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<gauge_t>& ptr = m_gauge[name];
+    if (!ptr)
+        ptr.reset(new gauge_t);
+    return *ptr;
+}
+
+/// <summary>
+/// Метод получения (регистрации) гистограммы
+/// </summary>
+/// <param name="name"> - имя метрики </param>
+/// <returns> ссылка на гистограмму, валидна все время жизни реестра </returns>
+histogram_t& metrics_t::Histogram(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<histogram_t>& ptr = m_histogram[name];
+    if (!ptr)
+        ptr.reset(new histogram_t);
+    return *ptr;
+}
+
+/// <summary>
+/// Метод вывода снимка всех метрик в текстовом виде "имя значение"
+/// </summary>
+/// <param name="buf"> - буфер для вывода </param>
+void metrics_t::Print(std::string& buf) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& it : m_counter)
+        buf += it.first + ' ' + std::to_string(it.second->Get()) + '\n';
+
+    for (auto& it : m_gauge)
+        buf += it.first + ' ' + std::to_string(it.second->Get()) + '\n';
+
+    for (auto& it : m_histogram)
+    {
+        const histogram_t& h = *it.second;
+        buf += it.first + " count=" + std::to_string(h.Count()) + " mean=" + std::to_string(h.Mean())
+            + " p50=" + std::to_string(h.Percentile(50)) + " p90=" + std::to_string(h.Percentile(90))
+            + " p99=" + std::to_string(h.Percentile(99)) + " p999=" + std::to_string(h.Percentile(99.9))
+            + " max=" + std::to_string(h.Max()) + '\n';
+    }
+}
@@ -0,0 +1,196 @@
+﻿#pragma once
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <atomic>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+#define METRICS_SHARDS 16 // количество шардов счетчика (степень двойки)
+#define HISTOGRAM_SUB_BITS 4 // точность гистограммы: 2^4 линейных корзины на каждую степень двойки
+#define HISTOGRAM_MAX_BITS 40 // верхняя граница значений гистограммы 2^40
+
+/// <summary>
+/// Счетчик, разбитый на шарды по потокам. Инкремент не создает конкуренции за кэш-линию между потоками
+/// </summary>
+class counter_t
+{
+public:
+    counter_t();
+
+    /// <summary>
+    /// Метод увеличения счетчика
+    /// </summary>
+    /// <param name="value"> - приращение </param>
+    void Add(unsigned long long value = 1);
+
+    /// <summary>
+    /// Метод получения значения счетчика (сумма по шардам)
+    /// </summary>
+    /// <returns> значение счетчика </returns>
+    unsigned long long Get() const;
+protected:
+    /// <summary>
+    /// Метод получения индекса шарда текущего потока
+    /// </summary>
+    /// <returns> индекс шарда </returns>
+    static size_t shardIndex();
+
+    struct shard_t // шард занимает целую кэш-линию, значения соседних шардов не делят одну линию
+    {
+        std::atomic<unsigned long long> value;
+        char padding[64 - sizeof(std::atomic<unsigned long long>)];
+    };
+
+    shard_t shards[METRICS_SHARDS]; // шарды счетчика
+};
+
+/// <summary>
+/// Мгновенное значение (глубина очереди, количество клиентов и т.д.)
+/// </summary>
+class gauge_t
+{
+public:
+    gauge_t() : value(0)
+    {}
+
+    /// <summary>
+    /// Метод установки значения
+    /// </summary>
+    /// <param name="value"> - новое значение </param>
+    void Set(long long value)
+    {
+        this->value.store(value, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Метод изменения значения
+    /// </summary>
+    /// <param name="delta"> - приращение (может быть отрицательным) </param>
+    void Add(long long delta)
+    {
+        value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Метод получения значения
+    /// </summary>
+    /// <returns> текущее значение </returns>
+    long long Get() const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+protected:
+    std::atomic<long long> value; // значение
+};
+
+/// <summary>
+/// Гистограмма в стиле HDR: лог-линейные корзины с относительной погрешностью 1/2^HISTOGRAM_SUB_BITS,
+/// запись значения - один атомарный инкремент без блокировок
+/// </summary>
+class histogram_t
+{
+public:
+    histogram_t();
+
+    /// <summary>
+    /// Метод записи значения
+    /// </summary>
+    /// <param name="value"> - значение (обычно микросекунды) </param>
+    void Record(unsigned long long value);
+
+    /// <summary>
+    /// Метод получения количества записанных значений
+    /// </summary>
+    /// <returns> количество значений </returns>
+    unsigned long long Count() const;
+
+    /// <summary>
+    /// Метод получения перцентиля
+    /// </summary>
+    /// <param name="percent"> - перцентиль (0..100) </param>
+    /// <returns> верхняя граница корзины, в которую попал перцентиль </returns>
+    unsigned long long Percentile(double percent) const;
+
+    /// <summary>
+    /// Метод получения среднего значения
+    /// </summary>
+    /// <returns> среднее значение </returns>
+    unsigned long long Mean() const;
+
+    /// <summary>
+    /// Метод получения максимального значения
+    /// </summary>
+    /// <returns> максимальное значение </returns>
+    unsigned long long Max() const;
+protected:
+    static const size_t SUB_COUNT = 1 << HISTOGRAM_SUB_BITS; // корзин на степень двойки
+    static const size_t BUCKETS = (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * SUB_COUNT; // всего корзин
+
+    /// <summary>
+    /// Метод вычисления индекса корзины по значению
+    /// </summary>
+    static size_t bucketIndex(unsigned long long value);
+
+    /// <summary>
+    /// Метод вычисления верхней границы корзины
+    /// </summary>
+    static unsigned long long bucketValue(size_t index);
+
+    std::atomic<unsigned long long> buckets[BUCKETS]; // корзины
+    std::atomic<unsigned long long> sum; // сумма значений
+    std::atomic<unsigned long long> max; // максимум
+};
+
+/// <summary>
+/// Реестр метрик. Метрики регистрируются по имени при старте, на горячем пути используются полученные ссылки
+/// </summary>
+class metrics_t
+{
+public:
+    /// <summary>
+    /// Метод получения (регистрации) счетчика
+    /// </summary>
+    /// <param name="name"> - имя метрики </param>
+    /// <returns> ссылка на счетчик, валидна все время жизни реестра </returns>
+    counter_t& Counter(const std::string& name);
+
+    /// <summary>
+    /// Метод получения (регистрации) мгновенного значения
+    /// </summary>
+    /// <param name="name"> - имя метрики </param>
+    /// <returns> ссылка на значение, валидна все время жизни реестра </returns>
+    gauge_t& Gauge(const std::string& name);
+
+    /// <summary>
+    /// Метод получения (регистрации) гистограммы
+    /// </summary>
+    /// <param name="name"> - имя метрики </param>
+    /// <returns> ссылка на гистограмму, валидна все время жизни реестра </returns>
+    histogram_t& Histogram(const std::string& name);
+
+    /// <summary>
+    /// Метод вывода снимка всех метрик в текстовом виде "имя значение"
+    /// </summary>
+    /// <param name="buf"> - буфер для вывода </param>
+    void Print(std::string& buf) const;
+
+    /// <summary>
+    /// Метод получения монотонного времени для замеров
+    /// </summary>
+    /// <returns> время в микросекундах </returns>
+    static unsigned long long Now()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+protected:
+    mutable std::mutex mutex; // защита реестра (только регистрация и снимок)
+    std::map<std::string, std::unique_ptr<counter_t>> m_counter; // счетчики
+    std::map<std::string, std::unique_ptr<gauge_t>> m_gauge; // мгновенные значения
+    std::map<std::string, std::unique_ptr<histogram_t>> m_histogram; // гистограммы
+};
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,283 @@
+﻿#pragma once
+#ifndef MSG_H_
+#define MSG_H_
+
+#include <string>
+#include <string_view>
+
+#include "metrics.h"
+
+/// <summary>
+/// тип сообщений
+/// </summary>
+enum TypeMsg
+{
+    defaul, // неопознанное
+    normal, // нормальное, с полезной нагрузкой
+    // сервисные:
+    Exit, // отключение клиента
+    shutDown, // отключение сервера
+    linkOn, // собеседники на связи
+    printinfo, // вывод информации по соединению
+    join, // переход в комнату, текст - имя комнаты
+    leave, // выход из комнаты обратно в общую
+    priv, // личное сообщение, текст - "<id> <текст>" (id получателя от клиента, id отправителя - клиенту)
+    ping, // проверка связи, получатель отвечает pong
+    pong // ответ на ping
+};
+
+/// <summary>
+/// этапы прохождения сообщения через сервер, для каждого сообщение хранит отметку времени
+/// </summary>
+enum StageMsg
+{
+    recived, // сообщение целиком принято из сокета
+    parsed, // определен тип сообщения
+    routed, // получен мьютекс списка собеседников, начата рассылка
+    countStage // количество этапов
+};
+
+/// <summary>
+/// функция упаковки 4 символов заголовка "[XXXX]" в число для сравнения одной операцией
+/// </summary>
+/// <param name="header"> -- 4 символа между скобками заголовка </param>
+/// <returns> код заголовка </returns>
+constexpr unsigned headerCodeMsg(const char* header)
+{
+    return static_cast<unsigned>(static_cast<unsigned char>(header[0])) << 24
+        | static_cast<unsigned>(static_cast<unsigned char>(header[1])) << 16
+        | static_cast<unsigned>(static_cast<unsigned char>(header[2])) << 8
+        | static_cast<unsigned>(static_cast<unsigned char>(header[3]));
+}
+
+/// <summary>
+/// функция сборки кадра сообщения в переданную строку: заголовок + текст + EOM.
+/// Строка может быть с любым аллокатором (например std::pmr::string в арене сессии)
+/// </summary>
+/// <param name="out"> -- строка для кадра (прежнее содержимое стирается) </param>
+/// <param name="type"> -- тип сообщения </param>
+/// <param name="text"> -- текст сообщения (только для normal) </param>
+template<class String>
+void frameMsg(String& out, TypeMsg type, std::string_view text = std::string_view())
+{
+    out.clear();
+    switch (type)
+    {
+    case normal:
+        out.reserve(text.size() + 11);
+        out.append("[NORM]").append(text.data(), text.size()).append("[EOM]"); // полезная нагрузка лишь здесь
+        break;
+    case join:
+        out.reserve(text.size() + 11);
+        out.append("[JOIN]").append(text.data(), text.size()).append("[EOM]");
+        break;
+    case priv:
+        out.reserve(text.size() + 11);
+        out.append("[PRIV]").append(text.data(), text.size()).append("[EOM]");
+        break;
+    case leave:
+        out.assign("[LEAV][EOM]");
+        break;
+    case Exit:
+        out.assign("[EXIT][EOM]");
+        break;
+    case shutDown:
+        out.assign("[SHUT][EOM]");
+        break;
+    case linkOn:
+        out.assign("[LINK][EOM]");
+        break;
+    case printinfo:
+        out.assign("[INFO][EOM]");
+        break;
+    case ping:
+        out.assign("[PING][EOM]");
+        break;
+    case pong:
+        out.assign("[PONG][EOM]");
+        break;
+    default:
+        break;
+    }
+}
+
+/// <summary>
+/// класс декоратор над std::string для хранения сообщения, состоящего из 
+/// заголовка (тип сообщения)-6 символов + текст + конец сообщения(EOM)-5 символов
+/// </summary>
+class msg_t
+{
+public:
+    /// <summary>
+    /// контсруктор
+    /// </summary>
+    /// <param name="type"> -- тип сообщения</param>
+    /// <param name="text"> -- текст сообщения</param>
+    msg_t(TypeMsg type = TypeMsg::defaul, std::string_view text = std::string_view()) : offset(0), type(type), stamp()
+    {
+        frameMsg(this->text, type, text);
+    }
+
+    /// <summary>
+    /// метод получения не константной ссылки на внутренний std::string с сообщением.
+    /// После заполнения буфера тип нужно разобрать методом Decode()
+    /// </summary>
+    /// <returns> не константная ссылка на внутренний std::string с сообщением </returns>
+    std::string& Update()
+    {
+        offset = 0;
+        type = TypeMsg::defaul;
+        return text;
+    }
+
+    /// <summary>
+    /// метод получения константной ссылки на внутренний std::string с сообщением 
+    /// </summary>
+    /// <returns> константная ссылка на внутренний std::string с сообщением </returns>
+    const std::string& Str() const
+    {
+        return text;
+    }
+
+    /// <summary>
+    /// метод разбора типа принятого сообщения, вызывается один раз по завершении кадра.
+    /// Заголовок "[XXXX]" сравнивается одним 4-байтным числом, без выделения памяти
+    /// </summary>
+    /// <returns> типа сообщения </returns>
+    TypeMsg Decode()
+    {
+        type = TypeMsg::defaul;
+
+        if (text.size() >= 6 && text[0] == '[' && text[5] == ']')
+            switch (headerCodeMsg(text.data() + 1))
+            {
+            case headerCodeMsg("NORM"):
+                type = TypeMsg::normal;
+                break;
+            case headerCodeMsg("EXIT"):
+                type = TypeMsg::Exit;
+                break;
+            case headerCodeMsg("SHUT"):
+                type = TypeMsg::shutDown;
+                break;
+            case headerCodeMsg("LINK"):
+                type = TypeMsg::linkOn;
+                break;
+            case headerCodeMsg("INFO"):
+                type = TypeMsg::printinfo;
+                break;
+            case headerCodeMsg("JOIN"):
+                type = TypeMsg::join;
+                break;
+            case headerCodeMsg("LEAV"):
+                type = TypeMsg::leave;
+                break;
+            case headerCodeMsg("PRIV"):
+                type = TypeMsg::priv;
+                break;
+            case headerCodeMsg("PING"):
+                type = TypeMsg::ping;
+                break;
+            case headerCodeMsg("PONG"):
+                type = TypeMsg::pong;
+                break;
+            default:
+                break;
+            }
+
+        return type;
+    }
+
+    /// <summary>
+    /// метод получения типа сообщения
+    /// </summary>
+    /// <returns> типа сообщения, разобранный конструктором или Decode() </returns>
+    TypeMsg Type() const
+    {
+        return type;
+    }
+
+    /// <summary>
+    /// метод получения конца сообщения
+    /// </summary>
+    /// <returns> конец сообщения </returns>
+    std::string EOM() const
+    {
+        return "[EOM]";
+    }
+
+    /// <summary>
+    /// метод получения текста сообщения без заголовка и конца сообщения, без копирования.
+    /// Представление валидно до следующего изменения сообщения
+    /// </summary>
+    /// <returns> полезный текст сообщения либо расшифровка сервисного сообщения </returns>
+    std::string_view Payload() const
+    {
+        switch (type)
+        { // расшифровка сервесных сообщений
+        case TypeMsg::shutDown:
+            return "SYSTEM MSG: server get command shutdown";
+        case TypeMsg::Exit:
+            return "SYSTEM MSG: server get command exit from visavi client";
+        case TypeMsg::printinfo:
+            return "SYSTEM MSG: other visavi not connected";
+        case TypeMsg::linkOn:
+            return "SYSTEM MSG: server get connected from visavi";
+        case TypeMsg::leave:
+            return "SYSTEM MSG: server get command leave room";
+        case TypeMsg::normal: // текст без заголовка и конца сообщения
+        case TypeMsg::join: // имя комнаты
+        case TypeMsg::priv: // id и текст
+            return text.size() >= 11 ? std::string_view(text.data() + 6, text.size() - 11) : std::string_view();
+        default:
+            return "SYSTEM MSG: server recived defined message";
+        }
+    }
+
+    /// <summary>
+    /// метод задания смещения
+    /// </summary>
+    /// <param name="offset"> -- смещение </param>
+    void SetOffset(unsigned offset)
+    {
+        if (offset < text.size())
+            this->offset = offset;
+    }
+
+    /// <summary>
+    /// метод возврата смещения
+    /// </summary>
+    /// <returns> -- смещение </returns>
+    unsigned GetOffset() const
+    {
+        return offset;
+    }
+
+    /// <summary>
+    /// метод отметки времени прохождения этапа
+    /// </summary>
+    /// <param name="stage"> -- этап </param>
+    /// <returns> -- отметка времени, мкс </returns>
+    unsigned long long Stamp(StageMsg stage)
+    {
+        return stamp[stage] = metrics_t::Now();
+    }
+
+    /// <summary>
+    /// метод получения отметки времени этапа
+    /// </summary>
+    /// <param name="stage"> -- этап </param>
+    /// <returns> -- отметка времени, мкс (0 - этап не пройден) </returns>
+    unsigned long long GetStamp(StageMsg stage) const
+    {
+        return stamp[stage];
+    }
+
+protected:
+    std::string text; // строка хранящее сообщение, согласно формату, опраделенному выше
+    unsigned offset; // смещение от начала сообщения
+    TypeMsg type; // тип сообщения, разбирается один раз
+    unsigned long long stamp[StageMsg::countStage]; // отметки времени этапов, мкс
+};
+
+#endif /* MSG_H_ */
@@ -1,5 +1,20 @@
 #include "network.h"
 
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <signal.h>
+#else
+#include <fstream>
+#endif
+
+#define RECV_CHUNK 16384 //       
+#define SEND_FILE_CHUNK 65536 //     SendFile  sendfile()
+
+size_t network::TCP_socketClient_t::recvChunk = RECV_CHUNK;
+size_t network::TCP_socketClient_t::maxFrame = 0;
+
 #ifdef __WIN32__
 std::unordered_set<unsigned> g_journal; //       
 #endif
@@ -61,7 +76,7 @@ network::RAII_OSsock::~RAII_OSsock()
 ///     
 /// </summary>
 /// <returns>    </returns>
-int network::RAII_OSsock::GetError()
+int network::RAII_OSsock::GetError() const
 {
 #ifdef __WIN32__
     return WSAGetLastError();
@@ -76,8 +91,9 @@ int network::RAII_OSsock::GetError()
 /// <param name="socket"> -   </param>
 /// <param name="option"> - </param>
 /// <param name="logger"> -    </param>
-/// <returns> 1 -  </returns>
-bool network::RAII_OSsock::setSocketOpt(SOCKET sock, int option, log_t& logger)
+/// <param name="value"> -   ( -  ) </param>
+/// <returns> 1 - ; 0 -       ( ) </returns>
+bool network::RAII_OSsock::setSocketOpt(SOCKET sock, int option, log_t& logger, int value)
 {
     bool result = false;
 
@@ -86,18 +102,80 @@ bool network::RAII_OSsock::setSocketOpt(SOCKET sock, int option, log_t& logger)
     case option_t::NON_BLOCK: //     
     {
 #ifdef __WIN32__
-        u_long mode = 0;
+        u_long mode = value != 0; //   -  
         if (ioctlsocket(sock, FIONBIO, &mode))
             logger.doLog("RAII_OSsock - ioctlsocket ", GetError());//  
         else
             result = true;
 #else
-        if (fcntl(sock, F_SETFL, O_NONBLOCK))
-            logger.doLog("RAII_OSsock - ioctl ", GetError());//  
+        int flags = fcntl(sock, F_GETFL, 0); //     
+        if (flags == -1 || fcntl(sock, F_SETFL, value != 0 ? flags | O_NONBLOCK : flags & ~O_NONBLOCK))
+            logger.doLog("RAII_OSsock - fcntl ", GetError());//  
         else
             result = true;
 #endif
+        break;
     }
+    case option_t::NO_DELAY: //    
+        result = setIntOpt(sock, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY", logger);
+        break;
+    case option_t::SND_BUF:
+        result = setIntOpt(sock, SOL_SOCKET, SO_SNDBUF, value, "SO_SNDBUF", logger);
+        break;
+    case option_t::RCV_BUF:
+        result = setIntOpt(sock, SOL_SOCKET, SO_RCVBUF, value, "SO_RCVBUF", logger);
+        break;
+    case option_t::KEEP_IDLE:
+        result = setIntOpt(sock, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE", logger);
+#ifdef TCP_KEEPIDLE
+        result = result && setIntOpt(sock, IPPROTO_TCP, TCP_KEEPIDLE, value, "TCP_KEEPIDLE", logger);
+#else
+        result = false;
+        DO_LOG_LIMITED(logger, "RAII_OSsock - TCP_KEEPIDLE not supported");
+#endif
+        break;
+    case option_t::KEEP_INTVL:
+#ifdef TCP_KEEPINTVL
+        result = setIntOpt(sock, IPPROTO_TCP, TCP_KEEPINTVL, value, "TCP_KEEPINTVL", logger);
+#else
+        DO_LOG_LIMITED(logger, "RAII_OSsock - TCP_KEEPINTVL not supported");
+#endif
+        break;
+    case option_t::KEEP_CNT:
+#ifdef TCP_KEEPCNT
+        result = setIntOpt(sock, IPPROTO_TCP, TCP_KEEPCNT, value, "TCP_KEEPCNT", logger);
+#else
+        DO_LOG_LIMITED(logger, "RAII_OSsock - TCP_KEEPCNT not supported");
+#endif
+        break;
+    case option_t::USER_TIMEOUT:
+#ifdef TCP_USER_TIMEOUT
+        result = setIntOpt(sock, IPPROTO_TCP, TCP_USER_TIMEOUT, value, "TCP_USER_TIMEOUT", logger);
+#else
+        DO_LOG_LIMITED(logger, "RAII_OSsock - TCP_USER_TIMEOUT not supported");
+#endif
+        break;
+    case option_t::BUSY_POLL:
+#ifdef SO_BUSY_POLL
+        result = setIntOpt(sock, SOL_SOCKET, SO_BUSY_POLL, value, "SO_BUSY_POLL", logger);
+#else
+        DO_LOG_LIMITED(logger, "RAII_OSsock - SO_BUSY_POLL not supported");
+#endif
+        break;
+    case option_t::NOTSENT_LOWAT:
+#ifdef TCP_NOTSENT_LOWAT
+        result = setIntOpt(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, value, "TCP_NOTSENT_LOWAT", logger);
+#else
+        DO_LOG_LIMITED(logger, "RAII_OSsock - TCP_NOTSENT_LOWAT not supported");
+#endif
+        break;
+    case option_t::DEFER_ACCEPT:
+#ifdef TCP_DEFER_ACCEPT
+        result = setIntOpt(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, value, "TCP_DEFER_ACCEPT", logger);
+#else
+        DO_LOG_LIMITED(logger, "RAII_OSsock - TCP_DEFER_ACCEPT not supported");
+#endif
+        break;
     default:
         break;
     }
@@ -105,6 +183,47 @@ bool network::RAII_OSsock::setSocketOpt(SOCKET sock, int option, log_t& logger)
     return result;
 }
 
+/// <summary>
+///     setsockopt     
+/// </summary>
+/// <param name="socket"> -   </param>
+/// <param name="level"> -   </param>
+/// <param name="name"> -  </param>
+/// <param name="value"> -  </param>
+/// <param name="text"> -     </param>
+/// <param name="logger"> -    </param>
+/// <returns> 1 -  </returns>
+bool network::RAII_OSsock::setIntOpt(SOCKET sock, int level, int name, int value, const char* text, log_t& logger)
+{
+    if (0 == setsockopt(sock, level, name, reinterpret_cast<const char*>(&value), sizeof(value)))
+        return true;
+    //      -   (, SO_BUSY_POLL  CAP_NET_ADMIN)
+    DO_LOG_LIMITED(logger, std::string("RAII_OSsock - setsockopt ") + text + ' ', GetError());
+    return false;
+}
+
+// : , TCP_NODELAY, SO_SNDBUF, SO_RCVBUF, keepalive (, , ),
+// TCP_USER_TIMEOUT, SO_BUSY_POLL, TCP_NOTSENT_LOWAT, TCP_DEFER_ACCEPT.
+// -         [LINK],   TCP_DEFER_ACCEPT  .
+// SO_BUSY_POLL  CAP_NET_ADMIN  EPERM   ,      
+const network::sockProfile_t network::sockProfile_t::LOW_LATENCY = { "low_latency", true, 0, 0, 60, 10, 5, 30000, 0, 16384, 0 };
+const network::sockProfile_t network::sockProfile_t::LOW_LATENCY_BUSY_POLL = { "low_latency_busy_poll", true, 0, 0, 60, 10, 5, 30000, 50, 16384, 0 };
+const network::sockProfile_t network::sockProfile_t::BULK = { "bulk", false, 1 << 20, 256 * 1024, 60, 10, 5, 60000, 0, 0, 5 };
+const network::sockProfile_t network::sockProfile_t::FEDERATION = { "federation", true, 512 * 1024, 512 * 1024, 15, 5, 3, 15000, 0, 131072, 0 };
+
+/// <summary>
+///     
+/// </summary>
+/// <param name="name"> -   </param>
+/// <returns> , nullptr -   </returns>
+const network::sockProfile_t* network::sockProfile_t::Find(const std::string& name)
+{
+    for (const sockProfile_t* profile : { &LOW_LATENCY, &LOW_LATENCY_BUSY_POLL, &BULK, &FEDERATION })
+        if (name == profile->name)
+            return profile;
+    return nullptr;
+}
+
 #ifdef __WIN32__
 WSADATA network::RAII_OSsock::wsdata;
 int network::RAII_OSsock::countWSAusers = 0;
@@ -112,49 +231,167 @@ int network::RAII_OSsock::countWSAusers = 0;
 
 
 /// <summary>
-///     .         UpdateSockInfo()
+///    : IPv4 "..."  IPv6
 /// </summary>
-/// <returns>      </returns>
-sockaddr* network::sockInfo_t::setSockAddr()
+/// <param name="ip"> - IP  </param>
+/// <param name="port"> -   </param>
+/// <returns> 1 -  ; 0 -   ( ) </returns>
+bool network::endpoint_t::Parse(const char* ip, unsigned short port)
 {
-    return &Addr;
+    Clear();
+    //  InetPton    IPv4  IPv6   
+    //      ,  1 - 
+    if (inet_pton(AF_INET, ip, &addr.v4.sin_addr) == 1)
+    {
+        addr.v4.sin_family = AF_INET;
+        addr.v4.sin_port = htons(port); //  htons       TCP/IP
+        return true;
+    }
+    if (inet_pton(AF_INET6, ip, &addr.v6.sin6_addr) == 1)
+    {
+        addr.v6.sin6_family = AF_INET6;
+        addr.v6.sin6_port = htons(port);
+        return true;
+    }
+    Clear();
+    return false;
 }
 
 /// <summary>
-///     ,    Addr  setSockAddr()
+///   ,   
 /// </summary>
-void network::sockInfo_t::UpdateSockInfo()
+/// <param name="sa"> -  </param>
+/// <param name="size"> -   </param>
+/// <returns> 1 -   </returns>
+bool network::endpoint_t::Assign(const sockaddr* sa, size_t size)
 {
-    //      
-    IP_port.first.clear();
-    IP_port.second = 0;
+    Clear();
+    if (size > sizeof(addr))
+        return false;
+    memcpy(&addr, sa, size);
+    return true;
+}
 
-    sockaddr_in AddrIN; //        IP
-    memset(&AddrIN, 0, SizeAddr());
-    memmove(&AddrIN, &Addr, SizeAddr()); //Addr ==>> AddrIN
+/// <summary>
+///    
+/// </summary>
+/// <returns>   (0 -   ) </returns>
+unsigned short network::endpoint_t::GetPort() const
+{
+    if (GetFamily() == AF_INET)
+        return ntohs(addr.v4.sin_port);
+    if (GetFamily() == AF_INET6)
+        return ntohs(addr.v6.sin6_port);
+    return 0;
+}
 
-    char bufIP[32];//    IP
-    memset(bufIP, '\0', sizeof(bufIP));
+/// <summary>
+///      bind/connect/sendto ( )
+/// </summary>
+/// <returns>  ;    -  ( accept/recvfrom/getsockname) </returns>
+socklen_t network::endpoint_t::Size() const
+{
+    if (GetFamily() == AF_INET)
+        return sizeof(addr.v4);
+    return sizeof(addr);
+}
 
+/// <summary>
+///   IP      (  )
+/// </summary>
+/// <param name="buf"> -  </param>
+/// <param name="size"> -   (ENDPOINT_STRLEN  ) </param>
+/// <returns>  ; 0 -       </returns>
+size_t network::endpoint_t::FormatIP(char* buf, size_t size) const
+{
+    const void* ip = GetFamily() == AF_INET ? static_cast<const void*>(&addr.v4.sin_addr)
+        : GetFamily() == AF_INET6 ? static_cast<const void*>(&addr.v6.sin6_addr) : nullptr;
     //  InetNtop  - IPv4  IPv6      
-    if (inet_ntop(AF_INET, &AddrIN, bufIP, sizeof(bufIP)))
+    if (ip == nullptr || size == 0 || inet_ntop(GetFamily(), const_cast<void*>(ip), buf, size) == nullptr)
+        return 0;
+    return strlen(buf);
+}
+
+/// <summary>
+///     "IP:" ("[IPv6]:")    (  )
+/// </summary>
+/// <param name="buf"> -  </param>
+/// <param name="size"> -   (ENDPOINT_STRLEN  ) </param>
+/// <returns>  ; 0 -       </returns>
+size_t network::endpoint_t::Format(char* buf, size_t size) const
+{
+    bool b_v6 = GetFamily() == AF_INET6;
+    if (size < 2)
+        return 0;
+    size_t length = FormatIP(buf + b_v6, size - b_v6);
+    if (length == 0)
+        return 0;
+    if (b_v6)
     {
-        IP_port.first.assign(bufIP);
-        IP_port.second = ntohs(AddrIN.sin_port);
+        buf[0] = '[';
+        buf[++length] = ']';
+        ++length;
     }
-    else //  
-        logger.doLog("inet_ntop fail", GetError());
+    int written = snprintf(buf + length, size - length, ":%u", static_cast<unsigned>(GetPort()));
+    if (written < 0 || static_cast<size_t>(written) >= size - length)
+        return 0;
+    return length + written;
 }
 
 /// <summary>
-///     ,    Addr
+///      (, , IP,  IPv6)
 /// </summary>
-/// <param name="ip"> IP    "..." </param>
-/// <param name="port">   </param>
-void network::sockInfo_t::UpdateSockInfo(std::string ip, unsigned short port)
+/// <returns>  </returns>
+size_t network::endpoint_t::Hash() const
 {
-    IP_port.first.swap(ip);
-    IP_port.second = port;
+    // FNV-1a    :  sockaddr    
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size)
+        {
+            for (const unsigned char* byte = static_cast<const unsigned char*>(data); size--; ++byte)
+                hash = (hash ^ *byte) * 1099511628211ull;
+        };
+    unsigned short family = static_cast<unsigned short>(GetFamily());
+    mix(&family, sizeof(family));
+    if (family == AF_INET)
+    {
+        mix(&addr.v4.sin_port, sizeof(addr.v4.sin_port));
+        mix(&addr.v4.sin_addr, sizeof(addr.v4.sin_addr));
+    }
+    else if (family == AF_INET6)
+    {
+        mix(&addr.v6.sin6_port, sizeof(addr.v6.sin6_port));
+        mix(&addr.v6.sin6_addr, sizeof(addr.v6.sin6_addr));
+        mix(&addr.v6.sin6_scope_id, sizeof(addr.v6.sin6_scope_id));
+    }
+    return static_cast<size_t>(hash);
+}
+
+/// <summary>
+///      ( ,   Hash())
+/// </summary>
+/// <param name="other"> -   </param>
+/// <returns> 1 -   </returns>
+bool network::endpoint_t::operator==(const endpoint_t& other) const
+{
+    if (GetFamily() != other.GetFamily())
+        return false;
+    if (GetFamily() == AF_INET)
+        return addr.v4.sin_port == other.addr.v4.sin_port
+            && memcmp(&addr.v4.sin_addr, &other.addr.v4.sin_addr, sizeof(addr.v4.sin_addr)) == 0;
+    if (GetFamily() == AF_INET6)
+        return addr.v6.sin6_port == other.addr.v6.sin6_port && addr.v6.sin6_scope_id == other.addr.v6.sin6_scope_id
+            && memcmp(&addr.v6.sin6_addr, &other.addr.v6.sin6_addr, sizeof(addr.v6.sin6_addr)) == 0;
+    return true; //    
+}
+
+/// <summary>
+///      (       GetIP())
+/// </summary>
+/// <returns>      </returns>
+sockaddr* network::sockInfo_t::setSockAddr()
+{
+    return Addr.Data();
 }
 
 /// <summary>
@@ -162,12 +399,15 @@ void network::sockInfo_t::UpdateSockInfo(std::string ip, unsigned short port)
 /// </summary>
 /// <param name="logger"> -     </param>
 network::sockInfo_t::sockInfo_t(log_t& logger) : RAII_OSsock(logger), logger(logger)
-{
-    memset(&Addr, 0, sizeof(Addr));
-    IP_port.first.clear();
-    IP_port.second = 0;
-    sizeAddr = sizeof(Addr);
-}
+{}
+
+/// <summary>
+///       (    )
+/// </summary>
+/// <param name="endpoint"> -  </param>
+/// <param name="logger"> -     </param>
+network::sockInfo_t::sockInfo_t(const endpoint_t& endpoint, log_t& logger) : RAII_OSsock(logger), Addr(endpoint), logger(logger)
+{}
 
 /// <summary>
 ///   2- 
@@ -185,9 +425,7 @@ network::sockInfo_t::sockInfo_t(std::string ip, unsigned short port, log_t& logg
 /// </summary>
 network::sockInfo_t::~sockInfo_t()
 {
-    memset(&Addr, 0, sizeof(Addr));
-    IP_port.first.clear();
-    IP_port.second = 0;
+    Addr.Clear();
 }
 
 /// <summary>
@@ -198,42 +436,14 @@ network::sockInfo_t::~sockInfo_t()
 /// <returns> true - ; false -  </returns>
 bool network::sockInfo_t::setSockInfo(std::string ip, unsigned short port)
 {
-    bool result = false; // 
-
-    sockaddr_in AddrIN; //        IP
-    AddrIN.sin_family = AF_INET; //  
-    AddrIN.sin_port = htons(port); //    
-    //  htons       TCP/IP
-
-    //AddrIN.sin_addr -  IN_ADDR ,    IPv4.
-    // :
-    // NADDR_ANY    (0.0.0.0);
-    // INADDR_LOOPBAC  loopback (127.0.0.1);
-    // INADDR_BROADCAST  (255.255.255.255)
-    int inet_pton_state = inet_pton(AF_INET, ip.c_str(), &AddrIN.sin_addr);
-    //  InetPton    IPv4  IPv6   
-    //     
-    //  1 - , 0 -  , -1 - 
-
-    //    
-    if (inet_pton_state == 1) //  
+    if (!Addr.Parse(ip.c_str(), port))
     {
-        memset(&Addr, 0, SizeAddr());
-        memmove(&Addr, &AddrIN, SizeAddr()); //AddrIN ==>> Addr
-        result = true;
-        UpdateSockInfo(ip, port);
-    }
-    else if (inet_pton_state == 0) //   IP
         logger.doLog(std::string("setSockAddr Fail, invalid IP: ") + ip);
-    else //inet_pton fail
-        logger.doLog("inet_pton Fail,IP: " + ip, GetError());
-
-    if (result)//       
-    {
-        DEBUG_TRACE(logger, "setSockAddr: -> OK")
+        return false;
     }
 
-    return result;
+    DEBUG_TRACE(logger, "setSockAddr: -> OK")
+    return true;
 }
 
 /// <summary>
@@ -242,9 +452,7 @@ bool network::sockInfo_t::setSockInfo(std::string ip, unsigned short port)
 /// <param name="sockInfo"> -        IP </param>
 void network::sockInfo_t::setSockInfo(const sockInfo_t& sockInfo)
 {
-    memset(&Addr, 0, SizeAddr());
-    memmove(&Addr, &sockInfo.Addr, SizeAddr());
-    IP_port = sockInfo.IP_port;
+    Addr = sockInfo.Addr;
 }
 
 /// <summary>
@@ -253,7 +461,7 @@ void network::sockInfo_t::setSockInfo(const sockInfo_t& sockInfo)
 /// <returns>       </returns>
 const sockaddr* network::sockInfo_t::getSockAddr() const
 {
-    return &Addr;
+    return Addr.Data();
 }
 
 network::sockInfo_t network::sockInfo_t::GetSockInfo() const
@@ -261,22 +469,32 @@ network::sockInfo_t network::sockInfo_t::GetSockInfo() const
     return *this;
 }
 
+/// <summary>
+///      
+/// </summary>
+/// <returns>   </returns>
+const network::endpoint_t& network::sockInfo_t::GetEndpoint() const
+{
+    return Addr;
+}
+
 /// <summary>
 ///      
 /// </summary>
 /// <returns>     </returns>
 size_t network::sockInfo_t::SizeAddr() const
 {
-    return sizeAddr;
+    return Addr.Size();
 }
 
 /// <summary>
 ///   IP
 /// </summary>
-/// <returns> IP    "..." </returns>
+/// <returns> IP    "..." (    ) </returns>
 std::string network::sockInfo_t::GetIP() const
 {
-    return IP_port.first;
+    char bufIP[ENDPOINT_STRLEN];//    IP
+    return std::string(bufIP, Addr.FormatIP(bufIP, sizeof(bufIP)));
 }
 
 /// <summary>
@@ -285,7 +503,7 @@ std::string network::sockInfo_t::GetIP() const
 /// <returns>   </returns>
 unsigned short network::sockInfo_t::GetPort() const
 {
-    return IP_port.second;
+    return Addr.GetPort();
 }
 
 /// <summary>
@@ -294,8 +512,8 @@ unsigned short network::sockInfo_t::GetPort() const
 /// <param name="rValue"> -   </param>
 /// <returns> 1 -   </returns>
 bool network::sockInfo_t::operator == (const sockInfo_t& rValue) const
-{//    sockaddr ( )
-    return getSockAddr() == rValue.getSockAddr();
+{
+    return Addr == rValue.Addr;
 }
 
 /// <summary>
@@ -313,8 +531,9 @@ bool network::sockInfo_t::operator != (const sockInfo_t& rValue) const
 /// </summary>
 /// <param name="socket"> -   </param>
 /// <param name="nonBlock"> -    </param>
+/// <param name="b_localInfo"> -    (getsockname) </param>
 /// <returns> true -   , false -   </returns>
-bool network::socket_t::SetSocket(SOCKET socket, bool nonBlock)
+bool network::socket_t::SetSocket(SOCKET socket, bool nonBlock, bool b_localInfo)
 {
     bool result = false;
     //   
@@ -324,10 +543,10 @@ bool network::socket_t::SetSocket(SOCKET socket, bool nonBlock)
             Socket = socket;
             this->nonBlock = nonBlock; // accept    
             //    
-            socklen_t sizeAddr = SizeAddr();
-            if (!getsockname(Socket, setSockAddr(), &sizeAddr))
-                UpdateSockInfo();//   setSockAddr()
-            else
+            Addr.Clear();
+            socklen_t sizeAddr = Addr.Size(); //    -  
+            //        -   
+            if (b_localInfo && getsockname(Socket, setSockAddr(), &sizeAddr))
                 logger.doLog("getsockname fail", GetError());
 
             result = true;
@@ -344,11 +563,11 @@ bool network::socket_t::Close()
 {
     if (CheckValidSocket(false)) //   
         if (CLOSE_SOCKET(Socket)) // 
-            logger.doLog("closesocket fail", GetError());
+            DO_LOG_LIMITED(logger, "closesocket fail", GetError());
         else
         {
             Socket = INVALID_SOCKET; //  
-            UpdateSockInfo("", 0); //  
+            Addr.Clear(); //  
         }
 
     return Socket == INVALID_SOCKET;
@@ -360,7 +579,7 @@ bool network::socket_t::Close()
 void network::socket_t::Shutdown()
 {
     if (shutdown(Socket, SHUT) < 0 && GetError() != error_t::SOCKET_NON_CONNECTED)
-        logger.doLog("socket_t::Shutdown() fail, errno: ", GetError());
+        DO_LOG_LIMITED(logger, "socket_t::Shutdown() fail, errno: ", GetError());
 }
 
 /// <summary>
@@ -374,13 +593,13 @@ bool network::socket_t::Bind()
 {
     bool result = false;//
 
-    if (CheckValidSocket() && !IP_port.first.empty() && IP_port.second != 0) //      
+    if (CheckValidSocket() && Addr.GetFamily() != 0 && Addr.GetPort() != 0) //      
     {
         result = (bind(Socket, getSockAddr(), SizeAddr()) == 0); //    IP  
         if (result) //  
-            DEBUG_TRACE(logger, "bind -> ok " + IP_port.first + '.' + std::to_string(IP_port.second));
+            DEBUG_TRACE(logger, "bind -> ok " + GetIP() + '.' + std::to_string(GetPort()));
         else
-            logger.doLog("bind -> fail " + IP_port.first + '.' + std::to_string(IP_port.second), GetError());
+            logger.doLog("bind -> fail " + GetIP() + '.' + std::to_string(GetPort()), GetError());
     }
     else //   Bind()      
         logger.doLog("bind invalid IP_port");
@@ -457,7 +676,7 @@ network::socket_t::socket_t(int af, int type, int protocol, std::string ip, unsi
 /// </param>
 /// <param name="sockInfo"> -     
 /// <param name="logger"> -     </param>
-network::socket_t::socket_t(int af, int type, int protocol, sockInfo_t sockInfo, log_t& logger) : socket_t(af, type, protocol, logger)
+network::socket_t::socket_t(int af, int type, int protocol, const sockInfo_t& sockInfo, log_t& logger) : socket_t(af, type, protocol, logger)
 {
     setSockInfo(sockInfo);
     Bind();
@@ -506,16 +725,48 @@ bool network::socket_t::setNonBlock()
     return nonBlock;
 }
 
+/// <summary>
+///    
+/// </summary>
+/// <param name="profile"> -  </param>
+/// <param name="b_listener"> - 1 -   (TCP_DEFER_ACCEPT    ) </param>
+/// <returns> 1 -     </returns>
+bool network::socket_t::ApplyProfile(const sockProfile_t& profile, bool b_listener)
+{
+    if (!CheckValidSocket(false))
+        return false;
+
+    const struct { int option; int value; } a_opt[] = {
+        { option_t::NO_DELAY, profile.b_noDelay ? 1 : 0 },
+        { option_t::SND_BUF, profile.sndBuf },
+        { option_t::RCV_BUF, profile.rcvBuf },
+        { option_t::KEEP_IDLE, profile.keepIdle },
+        { option_t::KEEP_INTVL, profile.keepIdle != 0 ? profile.keepIntvl : 0 },
+        { option_t::KEEP_CNT, profile.keepIdle != 0 ? profile.keepCnt : 0 },
+        { option_t::USER_TIMEOUT, profile.userTimeout },
+        { option_t::BUSY_POLL, profile.busyPoll },
+        { option_t::NOTSENT_LOWAT, profile.notSentLowat },
+        { option_t::DEFER_ACCEPT, b_listener ? profile.deferAccept : 0 } };
+
+    bool result = true;
+    for (const auto& opt : a_opt)
+        if (opt.value != 0) // 0 -  
+            result &= RAII_OSsock::setSocketOpt(Socket, opt.option, logger, opt.value);
+    return result;
+}
+
 /// <summary>
 ///  ,      ,       acept()
 /// </summary>
 /// <param name="socket"> -    </param>
-/// <param name="sockInfo"> -   </param>
+/// <param name="remote"> -    </param>
+/// <param name="nonBlock"> -    </param>
+/// <param name="b_localInfo"> -    (getsockname) </param>
 /// <returns> true -   </returns>
-bool network::TCP_socketClient_t::SetSocket(SOCKET socket, sockInfo_t sockInfo)
+bool network::TCP_socketClient_t::SetSocket(SOCKET socket, const endpoint_t& remote, bool nonBlock, bool b_localInfo)
 {
-    bool result = (b_connected = socket_t::SetSocket(socket, false));
-    if (result) serverInfo.setSockInfo(sockInfo);
+    bool result = (b_connected = socket_t::SetSocket(socket, nonBlock, b_localInfo));
+    if (result) serverInfo = remote;
     return result;
 }
 
@@ -527,6 +778,41 @@ network::TCP_socketClient_t::~TCP_socketClient_t()
     Shutdown();
 }
 
+/// <summary>
+///            (  )
+/// </summary>
+/// <param name="size"> - ,  </param>
+void network::TCP_socketClient_t::SetRecvChunk(size_t size)
+{
+    recvChunk = size;
+}
+
+/// <summary>
+///       
+/// </summary>
+/// <returns> ,  </returns>
+size_t network::TCP_socketClient_t::GetRecvChunk()
+{
+    return recvChunk;
+}
+
+/// <summary>
+///           (  )
+/// </summary>
+/// <param name="size"> -    ,  (0 -  ) </param>
+void network::TCP_socketClient_t::SetMaxFrame(size_t size)
+{
+    maxFrame = size;
+}
+
+/// <summary>
+///    ,     recv()    , -  ,
+///    .     
+/// </summary>
+/// <param name="size"> -   </param>
+void network::TCP_socketClient_t::onRecive(size_t /*size*/)
+{}
+
 /// <summary>
 ///     ()  
 /// </summary>
@@ -535,13 +821,22 @@ void network::TCP_socketClient_t::Move(TCP_socketClient_t& source)
 {
     if (Close() && socket_t::SetSocket(source.getSocket(), source.nonBlock))
     {
-        serverInfo.setSockInfo(source.serverInfo);
+        serverInfo = source.serverInfo;
         b_connected = source.b_connected;
+        sendError = source.sendError;
+        rxBuf.swap(source.rxBuf); //      
+        rxHead = source.rxHead;
+        rxScanned = source.rxScanned;
+        q_rxEnd.swap(source.q_rxEnd);
+        source.rxBuf.clear();
+        source.rxHead = source.rxScanned = 0;
+        source.q_rxEnd.clear();
         source.b_connected = false;
+        source.sendError = 0;
         source.Socket = INVALID_SOCKET;
         source.nonBlock = false;
-        source.serverInfo.UpdateSockInfo("", 0);
-        source.UpdateSockInfo("", 0);
+        source.serverInfo.Clear();
+        source.Addr.Clear();
     }
 }
 
@@ -549,7 +844,7 @@ void network::TCP_socketClient_t::Move(TCP_socketClient_t& source)
 ///   1 
 /// </summary>
 /// <param name="logger"> -    </param>
-network::TCP_socketClient_t::TCP_socketClient_t(log_t& logger) : socket_t(logger), b_connected(false), serverInfo(logger)
+network::TCP_socketClient_t::TCP_socketClient_t(log_t& logger) : socket_t(logger), b_connected(false), sendError(0), rxHead(0), rxScanned(0)
 {}
 
 /// <summary>
@@ -558,20 +853,23 @@ network::TCP_socketClient_t::TCP_socketClient_t(log_t& logger) : socket_t(logger
 /// <param name="ip_server"> - IP     "..." </param>
 /// <param name="port_server"> -    </param>
 /// <param name="logger"> -   </param>
-network::TCP_socketClient_t::TCP_socketClient_t(std::string ip_server, unsigned short port_server, log_t& logger) : socket_t(AF_INET, SOCK_STREAM, 0, logger), b_connected(false), serverInfo(logger)
+network::TCP_socketClient_t::TCP_socketClient_t(std::string ip_server, unsigned short port_server, log_t& logger) : socket_t(AF_INET, SOCK_STREAM, 0, logger), b_connected(false),
+    sendError(0), rxHead(0), rxScanned(0)
 {
-    if (serverInfo.setSockInfo(ip_server, port_server)) //      
+    if (serverInfo.Parse(ip_server.c_str(), port_server)) //      
         Connected(); //    
+    else
+        this->logger.doLog(std::string("TCP_socketClient_t invalid server IP: ") + ip_server);
 }
 
 /// <summary>
 ///   2 
 /// </summary>
-/// <param name="serverSockInfo"> -    </param>
+/// <param name="server"> -   </param>
 /// <param name="logger"> -   </param>
-network::TCP_socketClient_t::TCP_socketClient_t(sockInfo_t serverSockInfo, log_t& logger) : socket_t(AF_INET, SOCK_STREAM, 0, logger), b_connected(false), serverInfo(logger)
+network::TCP_socketClient_t::TCP_socketClient_t(const endpoint_t& server, log_t& logger) : socket_t(AF_INET, SOCK_STREAM, 0, logger), b_connected(false),
+    sendError(0), serverInfo(server), rxHead(0), rxScanned(0)
 {
-    serverInfo.setSockInfo(serverSockInfo); //    
     Connected(); //  
 }
 
@@ -585,9 +883,14 @@ network::TCP_socketClient_t::TCP_socketClient_t(sockInfo_t serverSockInfo, log_t
 ///           N>0 -  N ;
 ///           -1 -  ;
 ///           -2 -     ;
-///           -3 -    ( )</returns>
+///           -3 -    ( );
+///           -4 -   ,    ;
+///           -5 -    SetMaxFrame(),   </returns>
 int network::TCP_socketClient_t::Recive(std::string& str_bufer, const std::string str_EndOfMessege, const size_t sizeMsg)
 {
+    if (!nonBlock && !str_EndOfMessege.empty() && sizeMsg == 0) //     -    
+        return reciveFrame(str_bufer, str_EndOfMessege);
+
     int result = -1;
     //   
     if (b_connected && CheckValidSocket(false))
@@ -595,7 +898,7 @@ int network::TCP_socketClient_t::Recive(std::string& str_bufer, const std::strin
         if (!nonBlock) //    
             str_bufer.clear(); //   
         
-        std::string tempStr(2048, '\0'); //       
+        std::string tempStr(recvChunk, '\0'); //       
         int reciveSize = 0; //   
         bool EOM = str_EndOfMessege.empty() && (sizeMsg == 0); // EndOfMessege   
         //   
@@ -604,17 +907,12 @@ int network::TCP_socketClient_t::Recive(std::string& str_bufer, const std::strin
 
             if (reciveSize > 0)
             {//   
-                DEBUG_TRACE(logger, "Recive msg: " + tempStr)
-                    tempStr.assign(tempStr.c_str()); //    '\0';
-                str_bufer += tempStr; //   
-                tempStr.clear(); //  
-
-                if (!str_EndOfMessege.empty())
-                { //   EOM
-                    int pos = str_bufer.size() - str_EndOfMessege.size(); //     
-                    if (pos >= 0) //   
-                        EOM = (str_bufer.rfind(str_EndOfMessege) == pos); //     
-                }
+                DEBUG_TRACE(logger, "Recive msg: " + std::string(&tempStr[0], reciveSize))
+                str_bufer.append(&tempStr[0], reciveSize); //     ,       recv
+
+                if (!str_EndOfMessege.empty() && str_bufer.size() >= str_EndOfMessege.size()) //   EOM,    
+                    EOM = 0 == str_bufer.compare(str_bufer.size() - str_EndOfMessege.size(), str_EndOfMessege.size(), str_EndOfMessege);
+
                 if (sizeMsg != 0) //    
                     EOM |= (str_bufer.size() >= sizeMsg); // ,      
 
@@ -626,7 +924,7 @@ int network::TCP_socketClient_t::Recive(std::string& str_bufer, const std::strin
                     result = -3; //   ,  
                 else
                 {   //   , 
-                    logger.doLog("TCP_socketClient_t::Recive() fail, errno: ", GetError());
+                    DO_LOG_LIMITED(logger, "TCP_socketClient_t::Recive() fail, errno: ", GetError());
                     result = -1; //  
                     b_connected = false; //   
                 }
@@ -647,6 +945,87 @@ int network::TCP_socketClient_t::Recive(std::string& str_bufer, const std::strin
     return result;
 }
 
+/// <summary>
+///         .
+///      ,        
+/// </summary>
+/// <param name="str_frame"> -    (  ) </param>
+/// <param name="str_EndOfMessege"> -   </param>
+/// <returns> 0 -  ; -1 -  ; -2 -  ; -4 -   ,    ;
+///           -5 -    SetMaxFrame(),    </returns>
+int network::TCP_socketClient_t::reciveFrame(std::string& str_frame, const std::string& str_EndOfMessege)
+{
+    str_frame.clear();
+
+    if (rxScanned < rxBuf.size())
+    { // ,  Preload(),   
+        frameScanner_t::Scan(rxBuf.data(), rxBuf.size(), rxScanned, str_EndOfMessege, q_rxEnd);
+        rxScanned = rxBuf.size();
+    }
+
+    while (q_rxEnd.empty()) //       -  
+    {
+        if (!b_connected || !CheckValidSocket(false))
+            return -2; //  
+        if (maxFrame != 0 && rxBuf.size() - rxHead > maxFrame)
+        { //  ,        -   
+            DO_LOG_LIMITED(logger, "TCP_socketClient_t::Recive() frame too long, bytes: " + std::to_string(rxBuf.size() - rxHead));
+            return -5; //   :       
+        }
+
+        if (rxHead > 0)
+        { //     ,     
+            rxBuf.erase(0, rxHead);
+            rxScanned -= rxHead;
+            rxHead = 0;
+        }
+
+        size_t oldSize = rxBuf.size();
+        rxBuf.resize(oldSize + recvChunk);
+        int reciveSize = recv(Socket, &rxBuf[oldSize], static_cast<int>(recvChunk), 0); //     
+        rxBuf.resize(oldSize + (reciveSize > 0 ? reciveSize : 0));
+
+        if (reciveSize > 0)
+        {
+            DEBUG_TRACE(logger, "Recive msg: " + std::string(rxBuf.data() + oldSize, reciveSize))
+            onRecive(static_cast<size_t>(reciveSize)); //    -   ,     
+            //           
+            size_t from = rxScanned + 1 > rxHead + str_EndOfMessege.size() ? rxScanned + 1 - str_EndOfMessege.size() : rxHead;
+            frameScanner_t::Scan(rxBuf.data(), rxBuf.size(), from, str_EndOfMessege, q_rxEnd);
+            rxScanned = rxBuf.size();
+        }
+        else if (reciveSize < 0)
+        {
+            if (GetError() == error_t::INTERRUPTED)
+                return -4; //   ,    
+#ifdef __WIN32__
+            if (!nonBlock && GetError() == error_t::NON_BLOCK_SOCKET_NOT_READY)
+                continue; // SendNow()       FIONBIO -  
+#endif
+            DO_LOG_LIMITED(logger, "TCP_socketClient_t::Recive() fail, errno: ", GetError());
+            b_connected = false; //  
+            return -1; //  
+        }
+        else
+        {
+            b_connected = false;
+            return -2; //  
+        }
+    }
+
+    size_t end = q_rxEnd.front(); //    
+    if (maxFrame != 0 && end - rxHead > maxFrame)
+    { //  ,    
+        DO_LOG_LIMITED(logger, "TCP_socketClient_t::Recive() frame too long, bytes: " + std::to_string(end - rxHead));
+        return -5;
+    }
+    q_rxEnd.pop_front();
+    str_frame.assign(rxBuf.data() + rxHead, end - rxHead);
+    rxHead = end;
+
+    return 0;
+}
+
 /// <summary>
 ///            
 /// </summary>
@@ -657,7 +1036,7 @@ int network::TCP_socketClient_t::Recive(std::string& str_bufer, const std::strin
 ///           -1 -  ;
 ///           -2 -     ;
 ///           -3 -      ( )</returns>
-int network::TCP_socketClient_t::Send(const std::string& str_bufer, const unsigned offset)
+int network::TCP_socketClient_t::Send(std::string_view str_bufer, const unsigned offset)
 {
     int result = -1;
     //   
@@ -667,20 +1046,23 @@ int network::TCP_socketClient_t::Send(const std::string& str_bufer, const unsign
         int sendSize = offset; //    
         //  
         do {
-            int tempSize = send(Socket, &str_bufer[sendSize], totalSendSize - sendSize, 0); //       
+            int tempSize = send(Socket, str_bufer.data() + sendSize, totalSendSize - sendSize, SEND_FLAGS); //       
             if (tempSize > 0)
             { //    
-                DEBUG_TRACE(logger, std::string(&str_bufer[sendSize], tempSize));
+                DEBUG_TRACE(logger, std::string(str_bufer.data() + sendSize, tempSize));
                 sendSize += tempSize;
                 result = (totalSendSize == sendSize) ? 0 : sendSize; //   ?
             }
             else if (tempSize < 0)
             {//    , ,    
+                if (GetError() == error_t::INTERRUPTED)
+                    continue; //     - 
                 if (nonBlock && GetError() == error_t::NON_BLOCK_SOCKET_NOT_READY)
                     result = -3; //   ,  
                 else //  ,     ,   
                 {
-                    logger.doLog("TCP_socketClient_t::Send() fail, errno: ", GetError());
+                    sendError = GetError(); //   ,      
+                    DO_LOG_LIMITED(logger, "TCP_socketClient_t::Send() fail, errno: ", sendError);
                     result = -1; //  
                     b_connected = false; //   
                 }
@@ -699,6 +1081,138 @@ int network::TCP_socketClient_t::Send(const std::string& str_bufer, const unsign
     return result;
 }
 
+/// <summary>
+///        ,    
+/// (    ,   )
+/// </summary>
+/// <param name="str_bufer"> -  </param>
+/// <returns> 0 -   ;
+///           N>0 -  N  (  ,   );
+///           -1 -  ;
+///           -2 -     ;
+///           -3 -    </returns>
+int network::TCP_socketClient_t::SendNow(std::string_view str_bufer)
+{
+    if (!b_connected || !CheckValidSocket(false))
+        return -2;
+
+#ifdef __WIN32__
+    //  MSG_DONTWAIT :         .
+    //       ,  ,    ,  recv()
+    if (!nonBlock && !RAII_OSsock::setSocketOpt(Socket, RAII_OSsock::option_t::NON_BLOCK, logger, 1))
+        return -3; //   -   ,   
+#endif
+    int sendSize = send(Socket, str_bufer.data(), str_bufer.size(), SEND_NOW_FLAGS);
+    int error = sendSize < 0 ? GetError() : 0;
+#ifdef __WIN32__
+    if (!nonBlock)
+        RAII_OSsock::setSocketOpt(Socket, RAII_OSsock::option_t::NON_BLOCK, logger, 0);
+#endif
+    if (sendSize == static_cast<int>(str_bufer.size()))
+        return 0;
+    if (sendSize >= 0)
+        return sendSize;
+    if (error == error_t::NON_BLOCK_SOCKET_NOT_READY)
+        return -3;
+    sendError = error;
+    DO_LOG_LIMITED(logger, "TCP_socketClient_t::SendNow() fail, errno: ", sendError);
+    return -1;
+}
+
+/// <summary>
+///        (Send, SendNow)  .
+///         ,    
+/// </summary>
+/// <returns>  , 0 -    </returns>
+int network::TCP_socketClient_t::GetSendError() const
+{
+    return sendError;
+}
+
+/// <summary>
+///     ( ).  Linux - sendfile():     
+///   ,     ;    -    Send()
+/// </summary>
+/// <param name="path"> -   </param>
+/// <param name="offset"> -   </param>
+/// <param name="size"> -   </param>
+/// <returns> 0 -   ;
+///           -1 -   (  );
+///           -2 -      </returns>
+int network::TCP_socketClient_t::SendFile(const std::string& path, unsigned long long offset, unsigned long long size)
+{
+    if (!b_connected || !CheckValidSocket(false))
+        return -2;
+
+#ifdef __linux__
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        DO_LOG_LIMITED(logger, "TCP_socketClient_t::SendFile() open " + path + " fail, errno: ", errno);
+        return -1;
+    }
+
+    //  sendfile()  MSG_NOSIGNAL: SIGPIPE      ,     
+    sigset_t pipeSet, oldSet;
+    sigemptyset(&pipeSet);
+    sigaddset(&pipeSet, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+
+    int result = 0;
+    off_t position = static_cast<off_t>(offset);
+    while (size > 0)
+    {
+        ssize_t sent = sendfile(Socket, fd, &position, static_cast<size_t>(std::min<unsigned long long>(size, 1 << 30)));
+        if (sent > 0)
+            size -= static_cast<unsigned long long>(sent);
+        else if (sent < 0 && errno == EINTR)
+            continue; //     - 
+        else
+        {
+            if (sent < 0)
+            {
+                DO_LOG_LIMITED(logger, "TCP_socketClient_t::SendFile() fail, errno: ", errno);
+                if (errno == EPIPE)
+                {
+                    timespec noWait = { 0, 0 };
+                    sigtimedwait(&pipeSet, nullptr, &noWait);
+                }
+                b_connected = false; //      
+            }
+            else
+                DO_LOG_LIMITED(logger, "TCP_socketClient_t::SendFile() file " + path + " is shorter than expected");
+            result = -1;
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+    close(fd);
+    return result;
+#else
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file.seekg(static_cast<std::streamoff>(offset)))
+    {
+        DO_LOG_LIMITED(logger, "TCP_socketClient_t::SendFile() open " + path + " fail");
+        return -1;
+    }
+    std::string chunk;
+    while (size > 0)
+    {
+        chunk.resize(static_cast<size_t>(std::min<unsigned long long>(size, SEND_FILE_CHUNK)));
+        if (!file.read(&chunk[0], static_cast<std::streamsize>(chunk.size())))
+        {
+            DO_LOG_LIMITED(logger, "TCP_socketClient_t::SendFile() file " + path + " is shorter than expected");
+            return -1;
+        }
+        int result = Send(chunk);
+        if (result != 0)
+            return result < 0 ? result : -1;
+        size -= chunk.size();
+    }
+    return 0;
+#endif
+}
+
 /// <summary>
 ///      
 /// </summary>
@@ -708,13 +1222,10 @@ bool network::TCP_socketClient_t::Connected()
     //   
     if (CheckValidSocket(false) && !b_connected)
     {   //      -   TCP -      SYN
-        if (0 != connect(Socket, serverInfo.getSockAddr(), serverInfo.SizeAddr()))
-            logger.doLog("TCP_socketClient_t non connected with server:", GetError());
+        if (0 != connect(Socket, serverInfo.Data(), serverInfo.Size()))
+            DO_LOG_LIMITED(logger, "TCP_socketClient_t non connected with server:", GetError());
         else
-        {   //    ,     (  )
             b_connected = true;
-            UpdateSockInfo();
-        }
     }
 
     return b_connected;
@@ -729,6 +1240,15 @@ bool network::TCP_socketClient_t::GetConnected() const
     return b_connected;
 }
 
+/// <summary>
+///        (  ,     )
+/// </summary>
+/// <returns>    </returns>
+const network::endpoint_t& network::TCP_socketClient_t::GetRemoteInfo() const
+{
+    return serverInfo;
+}
+
 /// <summary>
 ///    
 /// </summary>
@@ -742,23 +1262,81 @@ void network::TCP_socketClient_t::ResetConnected()
 /// </summary>
 void network::TCP_socketClient_t::Shutdown()
 {
-    if (b_connected)
+    if (CheckValidSocket(false)) // b_connected  :     ,  recv    
     {
         socket_t::Shutdown();
         b_connected = false;
     }
 }
 
+/// <summary>
+///   :        ,  
+/// </summary>
+void network::TCP_socketClient_t::ShutdownSend()
+{
+    if (b_connected && shutdown(Socket, SHUT_SEND) < 0 && GetError() != error_t::SOCKET_NON_CONNECTED)
+        DO_LOG_LIMITED(logger, "TCP_socketClient_t::ShutdownSend() fail, errno: ", GetError());
+}
+
+/// <summary>
+///       (   )
+/// </summary>
+/// <returns> ,     </returns>
+SOCKET network::TCP_socketClient_t::Detach()
+{
+    SOCKET socket = Socket;
+    Socket = INVALID_SOCKET; //     shutdown,  close
+    b_connected = false;
+    return socket;
+}
+
+/// <summary>
+///    ,       (  )
+/// </summary>
+/// <returns>     ,     </returns>
+std::string_view network::TCP_socketClient_t::Pending() const
+{
+    return std::string_view(rxBuf.data() + rxHead, rxBuf.size() - rxHead);
+}
+
+/// <summary>
+///       ( ,    ),
+///       
+/// </summary>
+/// <param name="bytes"> -  </param>
+void network::TCP_socketClient_t::Preload(std::string_view bytes)
+{
+    rxBuf.assign(bytes.data(), bytes.size());
+    rxHead = 0;
+    rxScanned = 0; //    
+    q_rxEnd.clear();
+}
+
 /// <summary>
 ///   3- 
 /// </summary>
 /// <param name="ip"> - IP    "..." </param>
 /// <param name="port"> -   </param>
 /// <param name="logger"> -   </param>
-network::TCP_socketServer_t::TCP_socketServer_t(std::string ip, unsigned short port, log_t& logger) : socket_t(AF_INET, SOCK_STREAM, 0, ip, port, logger)
-{ // listen    ,      
+/// <param name="backlog"> -     </param>
+/// <param name="profile"> -  ,   listen() (nullptr -  ) </param>
+/// <param name="inherited"> -  ,    :     bind/listen </param>
+network::TCP_socketServer_t::TCP_socketServer_t(std::string ip, unsigned short port, log_t& logger, int backlog, const sockProfile_t* profile,
+    SOCKET inherited) : socket_t(logger)
+{
+    if (inherited != INVALID_SOCKET)
+    { //         :      
+        SetSocket(inherited, false);
+        return;
+    }
+    Socket = socket(AF_INET, SOCK_STREAM, 0);
+    CheckValidSocket();
+    Bind(ip, port);
+    // listen    ,      
+    if (profile != nullptr)
+        ApplyProfile(*profile, true); //    ,     SYN
     if (CheckValidSocket(false))
-        if (0 != listen(Socket, SOMAXCONN))
+        if (0 != listen(Socket, backlog))
             this->logger.doLog("TCP_socketServer_t listen fali ", GetError());
 }
 
@@ -767,10 +1345,11 @@ network::TCP_socketServer_t::TCP_socketServer_t(std::string ip, unsigned short p
 /// </summary>
 /// <param name="sockInfo"> -    </param>
 /// <param name="logger"> -   </param>
-network::TCP_socketServer_t::TCP_socketServer_t(sockInfo_t sockInfo, log_t& logger) : socket_t(AF_INET, SOCK_STREAM, 0, sockInfo, logger)
+/// <param name="backlog"> -     </param>
+network::TCP_socketServer_t::TCP_socketServer_t(const sockInfo_t& sockInfo, log_t& logger, int backlog) : socket_t(AF_INET, SOCK_STREAM, 0, sockInfo, logger)
 {
     if (CheckValidSocket(false))
-        if (0 != listen(Socket, SOMAXCONN))
+        if (0 != listen(Socket, backlog))
             this->logger.doLog("TCP_socketServer_t listen fali ", GetError());
 }
 
@@ -788,18 +1367,17 @@ int network::TCP_socketServer_t::AddClient(TCP_socketClient_t& client)
 
     if (!client.CheckValidSocket(false) && CheckValidSocket(false))
     {
-        sockInfo_t tempInfo(logger); //    
-        socklen_t sizeAddr = tempInfo.SizeAddr(); //  
+        endpoint_t peer; //   
+        socklen_t sizeAddr = peer.Size(); //  
         //       .         .
         //     ,   accept   -,  
         //     .
-        SOCKET tempSocket = accept(Socket, tempInfo.setSockAddr(), &sizeAddr);
+        SOCKET tempSocket = accept(Socket, peer.Data(), &sizeAddr);
         if (tempSocket != INVALID_SOCKET)
         { //     ,   
-            tempInfo.UpdateSockInfo(); //    
-            if (client.SetSocket(tempSocket, tempInfo))
+            if (client.SetSocket(tempSocket, peer))
             { //  ?    
-                DEBUG_TRACE(logger, "addClient success" + tempInfo.GetIP() + std::to_string(tempInfo.GetPort()))
+                DEBUG_TRACE(logger, "addClient success, port " + std::to_string(peer.GetPort()))
                     result = 0;
             }
             else //     
@@ -808,7 +1386,7 @@ int network::TCP_socketServer_t::AddClient(TCP_socketClient_t& client)
         else if (GetError() == error_t::NON_BLOCK_SOCKET_NOT_READY && nonBlock)
             result = -2;
         else
-            logger.doLog("accept fail", GetError()); //    
+            DO_LOG_LIMITED(logger, "accept fail", GetError()); //    
     }
     else
         result = -3;
@@ -816,6 +1394,173 @@ int network::TCP_socketServer_t::AddClient(TCP_socketClient_t& client)
     return result;
 }
 
+/// <summary>
+///    :        
+///     .         .
+///    :    AddClient(client, accepted)  
+/// </summary>
+/// <param name="a_accepted"> -      </param>
+/// <param name="capacity"> -   </param>
+/// <param name="timeOut"> -  ,  (-1 -  ) </param>
+/// <param name="b_nonBlock"> -     (accept4 SOCK_NONBLOCK) </param>
+/// <returns> N>=0 -   (0 - ); -1 -   </returns>
+int network::TCP_socketServer_t::AcceptBatch(accepted_t* a_accepted, size_t capacity, int timeOut, bool b_nonBlock, const wakeup_t* wakeup)
+{
+    if (capacity == 0 || !CheckValidSocket(false) || !setNonBlock())
+        return -1;
+
+    //     ,   -  
+    unsigned long count_fd = (wakeup != nullptr && wakeup->Handle() != INVALID_SOCKET) ? 2 : 1;
+#ifdef __WIN32__
+    WSAPOLLFD fd[2] = { { Socket, POLLRDNORM, 0 }, { count_fd == 2 ? wakeup->Handle() : INVALID_SOCKET, POLLRDNORM, 0 } };
+    int ready = WSAPoll(fd, count_fd, timeOut);
+#else
+    pollfd fd[2] = { { Socket, POLLIN, 0 }, { count_fd == 2 ? wakeup->Handle() : INVALID_SOCKET, POLLIN, 0 } };
+    int ready = poll(fd, count_fd, timeOut);
+#endif
+    if (ready <= 0)
+    {
+        if (ready == 0 || GetError() == error_t::INTERRUPTED)
+            return 0;
+        logger.doLog("AcceptBatch poll fail", GetError());
+        return -1;
+    }
+    if (count_fd == 2 && fd[1].revents != 0)
+        return 0; //  :    ,  
+
+    size_t count = 0;
+    while (count < capacity)
+    {
+        accepted_t& accepted = a_accepted[count];
+        accepted.peer.Clear();
+        socklen_t sizeAddr = accepted.peer.Size();
+#ifdef __WIN32__
+        accepted.socket = accept(Socket, accepted.peer.Data(), &sizeAddr);
+        //       -   
+        if (accepted.socket != INVALID_SOCKET && !setSocketOpt(accepted.socket, option_t::NON_BLOCK, logger, b_nonBlock ? 1 : 0))
+        {
+            CLOSE_SOCKET(accepted.socket);
+            continue;
+        }
+#else //    CLOEXEC -     
+        accepted.socket = accept4(Socket, accepted.peer.Data(), &sizeAddr, SOCK_CLOEXEC | (b_nonBlock ? SOCK_NONBLOCK : 0));
+#endif
+        if (accepted.socket != INVALID_SOCKET)
+        {
+            ++count;
+            continue;
+        }
+
+        int error = GetError();
+        if (error == error_t::NON_BLOCK_SOCKET_NOT_READY)
+            break; //  
+        if (error == error_t::CONNECTION_ABORTED || error == error_t::INTERRUPTED)
+            continue; //   ,     -  
+        DO_LOG_LIMITED(logger, "AcceptBatch accept fail", error);
+        if (error != error_t::NO_DESCRIPTORS) //    ,  -  
+            return count > 0 ? static_cast<int>(count) : -1;
+        break;
+    }
+
+    return static_cast<int>(count);
+}
+
+/// <summary>
+///    ,  AcceptBatch ( getsockname   )
+/// </summary>
+/// <param name="client"> -         </param>
+/// <param name="accepted"> -   </param>
+/// <param name="b_nonBlock"> -    </param>
+/// <returns> 0 -   ; -1 -  ( ) </returns>
+int network::TCP_socketServer_t::AddClient(TCP_socketClient_t& client, const accepted_t& accepted, bool b_nonBlock)
+{
+    if (!client.CheckValidSocket(false) && client.SetSocket(accepted.socket, accepted.peer, b_nonBlock, false))
+        return 0;
+
+    logger.doLog("fail SetSocket in addClient", GetError());
+    CLOSE_SOCKET(accepted.socket);
+    return -1;
+}
+
+/// <summary>
+///    :     ,     
+/// </summary>
+void network::TCP_socketServer_t::StopListen()
+{
+    Close();
+}
+
+/// <summary>
+///         (   )
+/// </summary>
+/// <returns>    </returns>
+SOCKET network::TCP_socketServer_t::ListenSocket() const
+{
+    return getSocket();
+}
+
+/// <summary>
+/// 
+/// </summary>
+/// <param name="logger"> -   </param>
+network::wakeup_t::wakeup_t(log_t& logger) : RAII_OSsock(logger), handle(INVALID_SOCKET)
+{
+#ifdef __WIN32__ // eventfd :        
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int size = sizeof(addr);
+    handle = socket(AF_INET, SOCK_DGRAM, 0);
+    if (handle == INVALID_SOCKET || bind(handle, reinterpret_cast<sockaddr*>(&addr), size)
+        || getsockname(handle, reinterpret_cast<sockaddr*>(&addr), &size) || connect(handle, reinterpret_cast<sockaddr*>(&addr), size))
+    {
+        logger.doLog("wakeup_t create fail", GetError());
+        if (handle != INVALID_SOCKET)
+            CLOSE_SOCKET(handle);
+        handle = INVALID_SOCKET;
+    }
+#else
+    handle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (handle == INVALID_SOCKET)
+        logger.doLog("wakeup_t eventfd fail", GetError());
+#endif
+}
+
+/// <summary>
+/// 
+/// </summary>
+network::wakeup_t::~wakeup_t()
+{
+    if (handle != INVALID_SOCKET)
+        CLOSE_SOCKET(handle);
+}
+
+/// <summary>
+///   
+/// </summary>
+void network::wakeup_t::Signal()
+{
+    if (handle == INVALID_SOCKET)
+        return;
+#ifdef __WIN32__
+    char byte = 1;
+    send(handle, &byte, 1, 0);
+#else
+    unsigned long long one = 1;
+    if (write(handle, &one, sizeof(one)) < 0) //   ,    
+        return;
+#endif
+}
+
+/// <summary>
+///     poll (    Signal())
+/// </summary>
+/// <returns> , INVALID_SOCKET -    </returns>
+SOCKET network::wakeup_t::Handle() const
+{
+    return handle;
+}
+
 /// <summary>
 ///     ()  
 /// </summary>
@@ -824,11 +1569,11 @@ void network::UDP_socket_t::Move(UDP_socket_t& source)
 {
     if (Close() && socket_t::SetSocket(source.Socket, source.nonBlock))
     {
-        lastCommunicationSocket.setSockInfo(source.lastCommunicationSocket);
+        lastCommunicationSocket = source.lastCommunicationSocket;
         source.Socket = INVALID_SOCKET;
         source.nonBlock = false;
-        source.lastCommunicationSocket.UpdateSockInfo("", 0);
-        source.UpdateSockInfo("", 0);
+        source.lastCommunicationSocket.Clear();
+        source.Addr.Clear();
     }
 }
 
@@ -851,7 +1596,7 @@ void network::UDP_socket_t::setMTU()
 ///   1 
 /// </summary>
 /// <param name="logger"> -    </param>
-network::UDP_socket_t::UDP_socket_t(log_t& logger) : socket_t(AF_INET, SOCK_DGRAM, 0, logger), lastCommunicationSocket(logger)
+network::UDP_socket_t::UDP_socket_t(log_t& logger) : socket_t(AF_INET, SOCK_DGRAM, 0, logger)
 {
     setMTU();
 }
@@ -862,7 +1607,7 @@ network::UDP_socket_t::UDP_socket_t(log_t& logger) : socket_t(AF_INET, SOCK_DGRA
 /// <param name="ip"> - IP    "..." </param>
 /// <param name="port"> -   </param>
 /// <param name="logger"> -   </param>
-network::UDP_socket_t::UDP_socket_t(std::string ip, unsigned short port, log_t& logger) : socket_t(AF_INET, SOCK_DGRAM, 0, ip, port, logger), lastCommunicationSocket(logger)
+network::UDP_socket_t::UDP_socket_t(std::string ip, unsigned short port, log_t& logger) : socket_t(AF_INET, SOCK_DGRAM, 0, ip, port, logger)
 {
     setMTU();
 }
@@ -872,7 +1617,7 @@ network::UDP_socket_t::UDP_socket_t(std::string ip, unsigned short port, log_t&
 /// </summary>
 /// <param name="sockInfo"> -    </param>
 /// <param name="logger"> -   </param>
-network::UDP_socket_t::UDP_socket_t(sockInfo_t& sockInfo, log_t& logger) : socket_t(AF_INET, SOCK_DGRAM, 0, sockInfo, logger), lastCommunicationSocket(logger)
+network::UDP_socket_t::UDP_socket_t(sockInfo_t& sockInfo, log_t& logger) : socket_t(AF_INET, SOCK_DGRAM, 0, sockInfo, logger)
 {
     setMTU();
 }
@@ -881,19 +1626,19 @@ network::UDP_socket_t::UDP_socket_t(sockInfo_t& sockInfo, log_t& logger) : socke
 ///        
 /// </summary>
 /// <param name="buffer"> -      </param>
-/// <param name="target"> -     </param>
+/// <param name="target"> -    </param>
 /// <returns> 0 -   ;
 ///         N>0 -  N ;
 ///          -1 -  ;
 ///          -2 -    MTU    
 ///          -3 -      ( ) </returns>
-int network::UDP_socket_t::SendTo(const std::string& buffer, sockInfo_t target)
+int network::UDP_socket_t::SendTo(const std::string& buffer, const endpoint_t& target)
 {
     int result = -1;
     //   
     if (CheckValidSocket(false) && buffer.size() < MTU())
     { //  sendto      
-        int sendSize = sendto(Socket, buffer.c_str(), buffer.size(), 0, target.getSockAddr(), target.SizeAddr());
+        int sendSize = sendto(Socket, buffer.c_str(), buffer.size(), 0, target.Data(), target.Size());
         //  
         if (sendSize > 0)
         { //    
@@ -905,7 +1650,7 @@ int network::UDP_socket_t::SendTo(const std::string& buffer, sockInfo_t target)
             if (GetError() == error_t::NON_BLOCK_SOCKET_NOT_READY && nonBlock)
                 result = -3; //    ()
             else
-                logger.doLog("sendto fail ", GetError()); //   
+                DO_LOG_LIMITED(logger, "sendto fail ", GetError()); //   
         }
         else if (buffer.empty()) //    ?     
             result = 0;
@@ -914,8 +1659,7 @@ int network::UDP_socket_t::SendTo(const std::string& buffer, sockInfo_t target)
         result = -2; //    MTU    
 
     //     ,     (   )
-    if (target != lastCommunicationSocket)
-        lastCommunicationSocket.setSockInfo(target);
+    lastCommunicationSocket = target;
 
     return result;
 }
@@ -947,9 +1691,12 @@ int network::UDP_socket_t::SendTo(const std::string& buffer)
 ///          -3 -      ( ) </returns>
 int network::UDP_socket_t::SendTo(const std::string& buffer, std::string ip, unsigned short port)
 {
-    if (lastCommunicationSocket.setSockInfo(ip, port)) //    ,   
-        return SendTo(buffer); // 
-    else return -1;
+    endpoint_t target;
+    if (target.Parse(ip.c_str(), port)) //    ,   
+        return SendTo(buffer, target); // 
+
+    logger.doLog(std::string("SendTo fail, invalid IP: ") + ip);
+    return -1;
 }
 
 /// <summary>
@@ -971,9 +1718,10 @@ int network::UDP_socket_t::RecvFrom(std::string& buffer, const std::string str_E
     {
         buffer.clear(); //  
         std::string tempStr(2048, '\0'); //       
-        socklen_t SizeAddr = lastCommunicationSocket.SizeAddr(); //   Addr
+        endpoint_t source; //  
+        socklen_t SizeAddr = source.Size(); //  
         //  recvfrom      
-        int recvSize = recvfrom(Socket, &tempStr[0], tempStr.size(), 0, lastCommunicationSocket.setSockAddr(), &SizeAddr);
+        int recvSize = recvfrom(Socket, &tempStr[0], tempStr.size(), 0, source.Data(), &SizeAddr);
 
         if (recvSize > 0)
         { //   
@@ -992,14 +1740,14 @@ int network::UDP_socket_t::RecvFrom(std::string& buffer, const std::string str_E
 
             result = EOM ? 0 : recvSize; //   ,  0,  -  
 
-            lastCommunicationSocket.UpdateSockInfo(); //    setSockAddr()
+            lastCommunicationSocket = source; //      
         }
         else if (recvSize < 0)
         { //   ,         
             if (GetError() == error_t::NON_BLOCK_SOCKET_NOT_READY && nonBlock)
                 result = -3;
             else
-                logger.doLog("recfrom fail ", GetError());
+                DO_LOG_LIMITED(logger, "recfrom fail ", GetError());
         }
         else
             result = -2; //  
@@ -1014,7 +1762,7 @@ int network::UDP_socket_t::RecvFrom(std::string& buffer, const std::string str_E
 ///           (/ )
 /// </summary>
 /// <returns>       (/ ) </returns>
-network::sockInfo_t network::UDP_socket_t::GetLastCommunication() const
+const network::endpoint_t& network::UDP_socket_t::GetLastCommunication() const
 {
     return lastCommunicationSocket;
 }
@@ -1355,7 +2103,7 @@ bool network::NonBlockSocket_manager_t::Work(const int timeOut)
                 m_readyClient[v_fds[indx].fd] = m_clientSocket[v_fds[indx].fd];
     }
     else if (resPoll < 0) //  
-        logger.doLog("poll error", GetError());
+        DO_LOG_LIMITED(logger, "poll error", GetError());
 
     return !m_readySender.empty() || !m_readyReader.empty() || !m_readyServer.empty() || !m_readyClient.empty(); //      ?
 }
@@ -6,10 +6,14 @@
 #include <list>
 #include <map>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <memory>
+#include <cstring>
+#include <type_traits>
 
 #include "log.h"
+#include "frameScanner.h"
 
 #ifdef __WIN32__
 
@@ -26,6 +30,9 @@
 #pragma comment(lib, "Ws2_32.lib") //       : ws2_32.dll.     
 #define CLOSE_SOCKET(socket) closesocket(socket)
 #define SHUT SD_BOTH
+#define SHUT_SEND SD_SEND
+#define SEND_FLAGS 0
+#define SEND_NOW_FLAGS 0 //  Windows     : SendNow()     FIONBIO
 
 #else
 
@@ -33,15 +40,21 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>//
+#include <netinet/tcp.h>
+
 #include <poll.h>
 #include <unistd.h>//
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #define SOCKET int
 #define INVALID_SOCKET -1
 #define CLOSE_SOCKET(socket) close(socket) 
 #define SHUT SHUT_RDWR
+#define SHUT_SEND SHUT_WR
+#define SEND_FLAGS MSG_NOSIGNAL //     -  EPIPE,   SIGPIPE 
+#define SEND_NOW_FLAGS (MSG_NOSIGNAL | MSG_DONTWAIT)
 
 #endif
 
@@ -50,6 +63,37 @@
 /// </summary>
 namespace network
 {
+    /// <summary>
+    ///   TCP . 0 -    (  ).
+    /// ,    ,     
+    /// </summary>
+    struct sockProfile_t
+    {
+        const char* name; //    
+        bool b_noDelay; // TCP_NODELAY:    ,   ACK
+        int sndBuf; // SO_SNDBUF, 
+        int rcvBuf; // SO_RCVBUF,  (   -  listen(),    )
+        int keepIdle; // SO_KEEPALIVE + TCP_KEEPIDLE:    ,  (0 - keepalive  )
+        int keepIntvl; // TCP_KEEPINTVL:   , 
+        int keepCnt; // TCP_KEEPCNT:     
+        int userTimeout; // TCP_USER_TIMEOUT:       , 
+        int busyPoll; // SO_BUSY_POLL:     ,  ( net.core.busy_poll -  CAP_NET_ADMIN)
+        int notSentLowat; // TCP_NOTSENT_LOWAT:      , 
+        int deferAccept; // TCP_DEFER_ACCEPT,   : accept()    , 
+
+        static const sockProfile_t LOW_LATENCY; // :  ,  
+        static const sockProfile_t LOW_LATENCY_BUSY_POLL; //      (  CAP_NET_ADMIN)
+        static const sockProfile_t BULK; //  :  ,   
+        static const sockProfile_t FEDERATION; //   :  ,   
+
+        /// <summary>
+        ///     
+        /// </summary>
+        /// <param name="name"> -   </param>
+        /// <returns> , nullptr -   </returns>
+        static const sockProfile_t* Find(const std::string& name);
+    };
+
     /// <summary>
     ///     
     ///   RAII
@@ -67,15 +111,31 @@ namespace network
         struct option_t //   
         {
             static const int NON_BLOCK = 1; //  
+            static const int NO_DELAY = 2; //    (   )
+            static const int SND_BUF = 3; //   , 
+            static const int RCV_BUF = 4; //   , 
+            static const int KEEP_IDLE = 5; //  keepalive,    , 
+            static const int KEEP_INTVL = 6; //    keepalive, 
+            static const int KEEP_CNT = 7; //  keepalive    
+            static const int USER_TIMEOUT = 8; //    , 
+            static const int BUSY_POLL = 9; //     , 
+            static const int NOTSENT_LOWAT = 10; //   , 
+            static const int DEFER_ACCEPT = 11; // accept()    , 
         };
         struct error_t //  
         {
 #ifdef __WIN32__
             static constexpr int NON_BLOCK_SOCKET_NOT_READY = WSAEWOULDBLOCK; //   ,      
             static const int SOCKET_NON_CONNECTED = WSAENOTCONN;
+            static const int CONNECTION_ABORTED = WSAECONNRESET; //   ,    accept
+            static const int INTERRUPTED = WSAEINTR; //  
+            static const int NO_DESCRIPTORS = WSAEMFILE; //  
 #else
             static const int NON_BLOCK_SOCKET_NOT_READY = EWOULDBLOCK; //   ,      
             static const int SOCKET_NON_CONNECTED = ENOTCONN;
+            static const int CONNECTION_ABORTED = ECONNABORTED; //   ,    accept
+            static const int INTERRUPTED = EINTR; //  
+            static const int NO_DESCRIPTORS = EMFILE; //  
 #endif
         };
         /// <summary>
@@ -106,7 +166,7 @@ namespace network
         ///     
         /// </summary>
         /// <returns>    </returns>
-        int GetError();
+        int GetError() const;
 
         /// <summary>
         ///     
@@ -114,12 +174,140 @@ namespace network
         /// <param name="socket"> -   </param>
         /// <param name="option"> - </param>
         /// <param name="logger"> -    </param>
+        /// <param name="value"> -   ( -  , NON_BLOCK: 0 -   ) </param>
+        /// <returns> 1 - ; 0 -       ( ) </returns>
+        bool setSocketOpt(SOCKET socket, int option, log_t& logger, int value = 1);
+
+        /// <summary>
+        ///     setsockopt     
+        /// </summary>
+        /// <param name="socket"> -   </param>
+        /// <param name="level"> -   </param>
+        /// <param name="name"> -  </param>
+        /// <param name="value"> -  </param>
+        /// <param name="text"> -     </param>
+        /// <param name="logger"> -    </param>
         /// <returns> 1 -  </returns>
-        bool setSocketOpt(SOCKET socket, int option, log_t& logger);
+        bool setIntOpt(SOCKET socket, int level, int name, int value, const char* text, log_t& logger);
     protected :
         log_t& logger;
     };
 
+#define ENDPOINT_STRLEN 64 //    endpoint_t::Format() ("[IPv6]:"  )
+
+    /// <summary>
+    ///   IPv4/IPv6   : 28  (sockaddr_in6),  ,    .
+    ///       (accept,  , UDP),     
+    /// </summary>
+    struct endpoint_t
+    {
+        union
+        {
+            sockaddr sa; //  :  
+            sockaddr_in v4; // AF_INET
+            sockaddr_in6 v6; // AF_INET6
+        } addr; // 0   -   
+
+        endpoint_t()
+        {
+            Clear();
+        }
+
+        /// <summary>
+        ///   
+        /// </summary>
+        void Clear()
+        {
+            memset(&addr, 0, sizeof(addr));
+        }
+
+        /// <summary>
+        ///    : IPv4 "..."  IPv6
+        /// </summary>
+        /// <param name="ip"> - IP  </param>
+        /// <param name="port"> -   </param>
+        /// <returns> 1 -  ; 0 -   ( ) </returns>
+        bool Parse(const char* ip, unsigned short port);
+
+        /// <summary>
+        ///   ,   
+        /// </summary>
+        /// <param name="sa"> -  </param>
+        /// <param name="size"> -   </param>
+        /// <returns> 1 -   </returns>
+        bool Assign(const sockaddr* sa, size_t size);
+
+        int GetFamily() const
+        {
+            return addr.sa.sa_family;
+        }
+
+        /// <summary>
+        ///    
+        /// </summary>
+        /// <returns>   (0 -   ) </returns>
+        unsigned short GetPort() const;
+
+        /// <summary>
+        ///      bind/connect/sendto ( )
+        /// </summary>
+        /// <returns>  ;    -  ( accept/recvfrom/getsockname) </returns>
+        socklen_t Size() const;
+
+        const sockaddr* Data() const
+        {
+            return &addr.sa;
+        }
+
+        sockaddr* Data()
+        {
+            return &addr.sa;
+        }
+
+        /// <summary>
+        ///   IP      (  )
+        /// </summary>
+        /// <param name="buf"> -  </param>
+        /// <param name="size"> -   (ENDPOINT_STRLEN  ) </param>
+        /// <returns>  ; 0 -       </returns>
+        size_t FormatIP(char* buf, size_t size) const;
+
+        /// <summary>
+        ///     "IP:" ("[IPv6]:")    (  )
+        /// </summary>
+        /// <param name="buf"> -  </param>
+        /// <param name="size"> -   (ENDPOINT_STRLEN  ) </param>
+        /// <returns>  ; 0 -       </returns>
+        size_t Format(char* buf, size_t size) const;
+
+        /// <summary>
+        ///      (, , IP,  IPv6)
+        /// </summary>
+        /// <returns>  </returns>
+        size_t Hash() const;
+
+        bool operator==(const endpoint_t& other) const;
+
+        bool operator!=(const endpoint_t& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    static_assert(sizeof(endpoint_t) == sizeof(sockaddr_in6), "endpoint_t must stay a bare sockaddr_in6-sized value");
+    static_assert(std::is_trivially_copyable<endpoint_t>::value, "endpoint_t must stay trivially copyable");
+
+    /// <summary>
+    /// - endpoint_t  unordered-
+    /// </summary>
+    struct endpointHash_t
+    {
+        size_t operator()(const endpoint_t& endpoint) const
+        {
+            return endpoint.Hash();
+        }
+    };
+
     /// <summary>
     ///      
     /// </summary>
@@ -130,23 +318,11 @@ namespace network
         friend class TCP_socketClient_t; //   Move
     protected:
         /// <summary>
-        ///     .         UpdateSockInfo()
+        ///      (       GetIP())
         /// </summary>
         /// <returns>      </returns>
         sockaddr* setSockAddr();
 
-        /// <summary>
-        ///     ,    Addr  setSockAddr()
-        /// </summary>
-        void UpdateSockInfo();
-
-        /// <summary>
-        ///     ,    Addr
-        /// </summary>
-        /// <param name="ip"> IP    "..." </param>
-        /// <param name="port">   </param>
-        void UpdateSockInfo(std::string ip, unsigned short port);
-
     public:
         /// <summary>
         ///    
@@ -162,6 +338,13 @@ namespace network
         /// <param name="logger"> -     </param>
         sockInfo_t(std::string ip, unsigned short port, log_t& logger);
 
+        /// <summary>
+        ///       (    )
+        /// </summary>
+        /// <param name="endpoint"> -  </param>
+        /// <param name="logger"> -     </param>
+        sockInfo_t(const endpoint_t& endpoint, log_t& logger);
+
         virtual ~sockInfo_t();
 
         /// <summary>
@@ -187,6 +370,12 @@ namespace network
 
         sockInfo_t GetSockInfo() const;
 
+        /// <summary>
+        ///      
+        /// </summary>
+        /// <returns>   </returns>
+        const endpoint_t& GetEndpoint() const;
+
         /// <summary>
         ///      
         /// </summary>
@@ -196,7 +385,7 @@ namespace network
         /// <summary>
         ///   IP
         /// </summary>
-        /// <returns> IP    "..." </returns>
+        /// <returns> IP    "..." (    ) </returns>
         std::string GetIP() const;
 
         /// <summary>
@@ -219,9 +408,7 @@ namespace network
         /// <returns> 1 -    </returns>
         bool operator != (const sockInfo_t& rValue) const;
     protected:
-        std::pair<std::string, unsigned short> IP_port; // IP    
-        sockaddr Addr; //       
-        size_t sizeAddr; //   sockaddr
+        endpoint_t Addr; //     
         log_t& logger; //    
     };
 
@@ -237,8 +424,9 @@ namespace network
         /// </summary>
         /// <param name="socket"> -   </param>
         /// <param name="nonBlock"> -    </param>
+        /// <param name="b_localInfo"> -    (getsockname) </param>
         /// <returns> true -   , false -   </returns>
-        bool SetSocket(SOCKET socket, bool nonBlock);
+        bool SetSocket(SOCKET socket, bool nonBlock, bool b_localInfo = true);
 
         /// <summary>
         ///   
@@ -316,7 +504,7 @@ namespace network
         /// </param>
         /// <param name="sockInfo"> -     
         /// <param name="logger"> -     </param>
-        socket_t(int af, int type, int protocol, sockInfo_t sockInfo, log_t& logger);
+        socket_t(int af, int type, int protocol, const sockInfo_t& sockInfo, log_t& logger);
 
         //  -  ,   
         socket_t(const socket_t& sock) = delete;
@@ -342,6 +530,14 @@ namespace network
         /// </summary>
         /// <returns> 1 -    </returns>
         bool setNonBlock();
+
+        /// <summary>
+        ///    
+        /// </summary>
+        /// <param name="profile"> -  </param>
+        /// <param name="b_listener"> - 1 -   (TCP_DEFER_ACCEPT    ) </param>
+        /// <returns> 1 -     </returns>
+        bool ApplyProfile(const sockProfile_t& profile, bool b_listener = false);
     protected:
         SOCKET Socket; //  
         bool nonBlock; //   
@@ -358,9 +554,29 @@ namespace network
         ///  ,      ,       acept()
         /// </summary>
         /// <param name="socket"> -    </param>
-        /// <param name="sockInfo"> -   </param>
+        /// <param name="remote"> -    </param>
+        /// <param name="nonBlock"> -    </param>
+        /// <param name="b_localInfo"> -    (getsockname) </param>
         /// <returns> true -   </returns>
-        bool SetSocket(SOCKET socket, sockInfo_t sockInfo);
+        bool SetSocket(SOCKET socket, const endpoint_t& remote, bool nonBlock = false, bool b_localInfo = true);
+
+        /// <summary>
+        ///         .
+        ///      ,        
+        /// </summary>
+        /// <param name="str_frame"> -    (  ) </param>
+        /// <param name="str_EndOfMessege"> -   </param>
+        /// <returns> 0 -  ; -1 -  ; -2 -  ; -4 -   ;
+        ///           -5 -    SetMaxFrame(),    </returns>
+        int reciveFrame(std::string& str_frame, const std::string& str_EndOfMessege);
+
+    protected:
+        /// <summary>
+        ///    ,     recv()    , -  ,
+        ///     (,    ).     
+        /// </summary>
+        /// <param name="size"> -   </param>
+        virtual void onRecive(size_t size);
 
     public:
 
@@ -369,6 +585,24 @@ namespace network
         /// </summary>
         virtual ~TCP_socketClient_t();
 
+        /// <summary>
+        ///            (  )
+        /// </summary>
+        /// <param name="size"> - ,  </param>
+        static void SetRecvChunk(size_t size);
+
+        /// <summary>
+        ///       
+        /// </summary>
+        /// <returns> ,  </returns>
+        static size_t GetRecvChunk();
+
+        /// <summary>
+        ///           (  )
+        /// </summary>
+        /// <param name="size"> -    ,  (0 -  ) </param>
+        static void SetMaxFrame(size_t size);
+
         /// <summary>
         ///     ()  
         /// </summary>
@@ -392,9 +626,9 @@ namespace network
         /// <summary>
         ///   2 
         /// </summary>
-        /// <param name="serverSockInfo"> -    </param>
+        /// <param name="server"> -   </param>
         /// <param name="logger"> -   </param>
-        TCP_socketClient_t(sockInfo_t serverSockInfo, log_t& logger);
+        TCP_socketClient_t(const endpoint_t& server, log_t& logger);
 
         /// <summary>
         ///            
@@ -406,7 +640,9 @@ namespace network
         ///           N>0 -  N ;
         ///           -1 -  ;
         ///           -2 -     ;
-        ///           -3 -    ( )</returns>
+        ///           -3 -    ( );
+        ///           -4 -    ,   (   );
+        ///           -5 -    SetMaxFrame(),    (   )</returns>
         int Recive(std::string& str_bufer, const std::string str_EndOfMessege = "", const size_t sizeMsg = 0);
 
         /// <summary>
@@ -419,7 +655,38 @@ namespace network
         ///           -1 -  ;
         ///           -2 -     ;
         ///           -3 -      ( )</returns>
-        int Send(const std::string& str_bufer, const unsigned offset = 0);
+        int Send(std::string_view str_bufer, const unsigned offset = 0);
+
+        /// <summary>
+        ///        ,    
+        /// (    ,   )
+        /// </summary>
+        /// <param name="str_bufer"> -  </param>
+        /// <returns> 0 -   ;
+        ///           N>0 -  N  (  ,   );
+        ///           -1 -  ;
+        ///           -2 -     ;
+        ///           -3 -    </returns>
+        int SendNow(std::string_view str_bufer);
+
+        /// <summary>
+        ///        (Send, SendNow)  .
+        ///         ,    
+        /// </summary>
+        /// <returns>  , 0 -    </returns>
+        int GetSendError() const;
+
+        /// <summary>
+        ///     ( ).  Linux - sendfile():     
+        ///   ,     ;    -    Send()
+        /// </summary>
+        /// <param name="path"> -   </param>
+        /// <param name="offset"> -   </param>
+        /// <param name="size"> -   </param>
+        /// <returns> 0 -   ;
+        ///           -1 -   (  );
+        ///           -2 -      </returns>
+        int SendFile(const std::string& path, unsigned long long offset, unsigned long long size);
 
         /// <summary>
         ///      
@@ -433,18 +700,98 @@ namespace network
         /// <returns> 1 -   </returns>
         bool GetConnected() const;
 
+        /// <summary>
+        ///        (  ,     )
+        /// </summary>
+        /// <returns>    </returns>
+        const endpoint_t& GetRemoteInfo() const;
+
         /// <summary>
         ///    
         /// </summary>
         void ResetConnected();
 
         /// <summary>
-        ///   
+        ///    ( ,      ,      recv)
         /// </summary>
         void Shutdown();
+
+        /// <summary>
+        ///   :        ,  
+        /// </summary>
+        void ShutdownSend();
+
+        /// <summary>
+        ///       (   )
+        /// </summary>
+        /// <returns> ,     </returns>
+        SOCKET Detach();
+
+        /// <summary>
+        ///    ,       (  )
+        /// </summary>
+        /// <returns>     ,     </returns>
+        std::string_view Pending() const;
+
+        /// <summary>
+        ///       ( ,    ),
+        ///       
+        /// </summary>
+        /// <param name="bytes"> -  </param>
+        void Preload(std::string_view bytes);
     protected:
         bool b_connected; //     
-        sockInfo_t serverInfo; //   
+        int sendError; //     
+        endpoint_t serverInfo; //   
+        poolString_t rxBuf; //  ,     (   )
+        size_t rxHead; //     rxBuf
+        size_t rxScanned; // rxBuf      
+        frameEnds_t q_rxEnd; //  ,     
+
+        static size_t recvChunk; //     , 
+        static size_t maxFrame; //       ,  (0 -  )
+    };
+
+    /// <summary>
+    ///    AcceptBatch:       
+    /// </summary>
+    struct accepted_t
+    {
+        SOCKET socket; //   
+        endpoint_t peer; //   (    )
+    };
+
+    /// <summary>
+    ///       poll   :  Signal()  
+    ///   . Linux - eventfd, Windows - UDP    ,    .
+    /// Signal()  Linux -  write(),      
+    /// </summary>
+    class wakeup_t : private RAII_OSsock
+    {
+    public:
+        /// <summary>
+        /// 
+        /// </summary>
+        /// <param name="logger"> -   </param>
+        wakeup_t(log_t& logger);
+
+        wakeup_t(const wakeup_t&) = delete;
+        wakeup_t& operator=(const wakeup_t&) = delete;
+
+        ~wakeup_t();
+
+        /// <summary>
+        ///   
+        /// </summary>
+        void Signal();
+
+        /// <summary>
+        ///     poll (    Signal())
+        /// </summary>
+        /// <returns> , INVALID_SOCKET -    </returns>
+        SOCKET Handle() const;
+    private:
+        SOCKET handle; // eventfd  UDP 
     };
 
     /// <summary>
@@ -459,14 +806,19 @@ namespace network
         /// <param name="ip"> - IP    "..." </param>
         /// <param name="port"> -   </param>
         /// <param name="logger"> -   </param>
-        TCP_socketServer_t(std::string ip, unsigned short port, log_t& logger);
+        /// <param name="backlog"> -     </param>
+        /// <param name="profile"> -  ,   listen() (nullptr -  ) </param>
+        /// <param name="inherited"> -  ,    :     bind/listen </param>
+        TCP_socketServer_t(std::string ip, unsigned short port, log_t& logger, int backlog = SOMAXCONN, const sockProfile_t* profile = nullptr,
+            SOCKET inherited = INVALID_SOCKET);
 
         /// <summary>
         ///   2- 
         /// </summary>
         /// <param name="sockInfo"> -    </param>
         /// <param name="logger"> -   </param>
-        TCP_socketServer_t(sockInfo_t sockInfo, log_t& logger);
+        /// <param name="backlog"> -     </param>
+        TCP_socketServer_t(const sockInfo_t& sockInfo, log_t& logger, int backlog = SOMAXCONN);
 
         /// <summary>
         ///    
@@ -476,6 +828,39 @@ namespace network
         ///          -1 -  ,
         ///          -2 -       ( )</returns>
         int AddClient(TCP_socketClient_t& client);
+
+        /// <summary>
+        ///    :        
+        ///     .         .
+        ///    :    AddClient(client, accepted)  
+        /// </summary>
+        /// <param name="a_accepted"> -      </param>
+        /// <param name="capacity"> -   </param>
+        /// <param name="timeOut"> -  ,  (-1 -  ) </param>
+        /// <param name="b_nonBlock"> -     (accept4 SOCK_NONBLOCK) </param>
+        /// <param name="wakeup"> - ,   (nullptr -   ) </param>
+        /// <returns> N>=0 -   (0 -    ); -1 -   </returns>
+        int AcceptBatch(accepted_t* a_accepted, size_t capacity, int timeOut = -1, bool b_nonBlock = false, const wakeup_t* wakeup = nullptr);
+
+        /// <summary>
+        ///    ,  AcceptBatch ( getsockname   )
+        /// </summary>
+        /// <param name="client"> -         </param>
+        /// <param name="accepted"> -   </param>
+        /// <param name="b_nonBlock"> -    </param>
+        /// <returns> 0 -   ; -1 -  ( ) </returns>
+        int AddClient(TCP_socketClient_t& client, const accepted_t& accepted, bool b_nonBlock = false);
+
+        /// <summary>
+        ///    :     ,     
+        /// </summary>
+        void StopListen();
+
+        /// <summary>
+        ///         (   )
+        /// </summary>
+        /// <returns>    </returns>
+        SOCKET ListenSocket() const;
     };
 
     /// <summary>
@@ -521,13 +906,13 @@ namespace network
         ///        
         /// </summary>
         /// <param name="buffer"> -      </param>
-        /// <param name="target"> -     </param>
+        /// <param name="target"> -    </param>
         /// <returns> 0 -   ;
         ///         N>0 -  N ;
         ///          -1 -  ;
         ///          -2 -    MTU    ;
         ///          -3 -      ( ) </returns>
-        int SendTo(const std::string& buffer, sockInfo_t target);
+        int SendTo(const std::string& buffer, const endpoint_t& target);
 
         /// <summary>
         ///        ,       
@@ -569,8 +954,8 @@ namespace network
         /// <summary>
         ///           (/ )
         /// </summary>
-        /// <returns>       (/ ) </returns>
-        sockInfo_t GetLastCommunication() const;
+        /// <returns>        (/ ) </returns>
+        const endpoint_t& GetLastCommunication() const;
 
         /// <summary>
         ///   MTU
@@ -578,7 +963,7 @@ namespace network
         /// <returns>    </returns>
         unsigned int MTU() const;
     private:
-        sockInfo_t lastCommunicationSocket; //  ,    
+        endpoint_t lastCommunicationSocket; //  ,    
         unsigned int u32_MTU; //    
     };
 
@@ -105,7 +105,7 @@ task_t::~task_t()
 /// <summary>
 ///   
 /// </summary>
-thread_t::thread_t(std::condition_variable& cv_wakeUp, std::mutex& mtx_wakeUp) : thread([this](){ task.Work(); }), task(cv_wakeUp, mtx_wakeUp)
+thread_t::thread_t(std::condition_variable& cv_wakeUp, std::mutex& mtx_wakeUp) : task(cv_wakeUp, mtx_wakeUp), thread([this](){ task.Work(); })
 {}
 
 ///
@@ -179,6 +179,20 @@ bool poolThread_t::GetFree() const
 	return result;
 }
 
+/// <summary>
+///    
+/// </summary>
+/// <returns>  ,   </returns>
+size_t poolThread_t::CountActive() const
+{
+	size_t result = 0;
+	for (size_t index = 0; index < SIZE; ++index)
+		if (v_thread[index]->task.GetActive())
+			++result;
+
+	return result;
+}
+
 /// <summary>
 ///    
 /// </summary>
@@ -197,6 +211,8 @@ void poolThread_manager_t::Update()
 				if (iter->second.status == EXCEPTION && slave_pool.UpdateTask(iter->second.p_task, iter->first))
 				{ //           -   
 					iter->second.status = ACTIVE;
+					if (queueDepth) queueDepth->Add(-1);
+					if (waitTime) waitTime->Record(metrics_t::Now() - iter->second.enqueued);
 					++iter;
 				}
 				else if (iter->second.status == ACTIVE && !slave_pool.GetActiveTask(iter->first))
@@ -210,9 +226,13 @@ void poolThread_manager_t::Update()
 }
 
 /// <summary>
-///   
+/// 
 /// </summary>
-poolThread_manager_t::poolThread_manager_t(const size_t SIZE) : slave_pool(cv_condition, mutex, SIZE), counter(0), master_thread([this]() { Update(); }), stop(false)
+/// <param name="SIZE"> -     </param>
+/// <param name="metrics"> -   () </param>
+poolThread_manager_t::poolThread_manager_t(const size_t SIZE, metrics_t* metrics) : slave_pool(cv_condition, mutex, SIZE), counter(0),
+	queueDepth(metrics ? &metrics->Gauge("pool.queue_depth") : nullptr), waitTime(metrics ? &metrics->Histogram("pool.wait_us") : nullptr),
+	stop(false), master_thread([this]() { Update(); })
 {}
 
 /// <summary>
@@ -240,6 +260,9 @@ taskID poolThread_manager_t::AddTask(std::shared_ptr<ABStask> p_task)
 	std::lock_guard<std::mutex> lock(mutex);
 	m_task[result].p_task = p_task;
 	m_task[result].status = EXCEPTION;
+	m_task[result].enqueued = metrics_t::Now();
+	if (queueDepth) queueDepth->Add(1);
+
 	cv_condition.notify_one(); //   
 
 	return result;
@@ -268,3 +291,20 @@ int poolThread_manager_t::GetStatusTask(taskID ID)
 
 	return result;
 }
+
+/// <summary>
+///    
+/// </summary>
+/// <param name="threads"> -     </param>
+/// <param name="active"> -    </param>
+/// <param name="queued"> -       </param>
+void poolThread_manager_t::GetStatus(size_t& threads, size_t& active, size_t& queued) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	threads = slave_pool.SIZE;
+	active = slave_pool.CountActive();
+	queued = 0;
+	for (auto& it : m_task)
+		if (it.second.status == EXCEPTION)
+			++queued;
+}
@@ -10,6 +10,8 @@
 #include <vector>
 #include <memory>
 
+#include "metrics.h"
+
 typedef unsigned long long taskID; //  
 
 /// <summary>
@@ -91,8 +93,8 @@ struct thread_t
     virtual ~thread_t();
 
 protected :
+    task_t task; //  (  :       )
     std::thread thread; //  
-    task_t task; // 
 };
 
 
@@ -133,6 +135,12 @@ protected :
     /// <returns> 1 -       </returns>
     bool GetFree() const;
 
+    /// <summary>
+    ///    
+    /// </summary>
+    /// <returns>  ,   </returns>
+    size_t CountActive() const;
+
 protected:
     std::vector<std::shared_ptr<thread_t>> v_thread; //  
     std::vector<taskID> v_taskID; //  ID 
@@ -152,11 +160,12 @@ protected:
 struct status_p_task_t
 {
     friend class poolThread_manager_t;
-    status_p_task_t() : status(0), p_task(nullptr)
+    status_p_task_t() : status(0), p_task(nullptr), enqueued(0)
     {}
 protected :
     char status; //  
     std::shared_ptr<ABStask> p_task; //   
+    unsigned long long enqueued; //    , 
 };
 
 /// <summary>
@@ -173,9 +182,11 @@ protected:
    
 public:
     /// <summary>
-    ///   
+    /// 
     /// </summary>
-    poolThread_manager_t(const size_t SIZE);
+    /// <param name="SIZE"> -     </param>
+    /// <param name="metrics"> -   () </param>
+    poolThread_manager_t(const size_t SIZE, metrics_t* metrics = nullptr);
 
     /// <summary>
     /// 
@@ -199,14 +210,25 @@ public:
     ///           EXCEPTION (3) -       </returns>
     int GetStatusTask(taskID ID);
 
+    /// <summary>
+    ///    
+    /// </summary>
+    /// <param name="threads"> -     </param>
+    /// <param name="active"> -    </param>
+    /// <param name="queued"> -       </param>
+    void GetStatus(size_t& threads, size_t& active, size_t& queued) const;
+
 protected :
     poolThread_t slave_pool; //   
     taskID counter; // 
     std::map<taskID, status_p_task_t> m_task; //          
-    std::thread master_thread; //  ,   ,    
+    gauge_t* queueDepth; // :       ()
+    histogram_t* waitTime; // :     ,  ()
+
     std::condition_variable cv_condition; //  ,      
     mutable std::mutex mutex;//  -   
     volatile std::atomic_bool stop; //    
+    std::thread master_thread; //  ,   ,     ( )
 };
 
 
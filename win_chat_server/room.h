@@ -0,0 +1,143 @@
+﻿#pragma once
+#ifndef ROOM_H_
+#define ROOM_H_
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <vector>
+#include <atomic>
+
+#include "slotMap.h"
+
+#define ROOM_SHARDS 16 // количество шардов индекса комнат
+#define ROOM_NAME_MAX 32 // максимальная длина имени комнаты
+#define ROOM_LOBBY "" // комната по умолчанию, в нее попадает каждый новый собеседник
+
+/// <summary>
+/// комната: участники и свой мьютекс. Смена состава идет под мьютексом комнаты и публикует новый
+/// неизменяемый снимок участников (read-copy-update); рассылка читает снимок без мьютекса.
+/// Старый снимок держит своих участников, пока его не отпустит последний читатель
+/// </summary>
+template<class Member>
+struct room_t
+{
+    typedef std::shared_ptr<Member> member_p;
+    typedef std::vector<member_p> snapshot_t;
+    typedef std::shared_ptr<const snapshot_t> snapshot_p;
+
+    /// <summary>
+    /// конструктор
+    /// </summary>
+    /// <param name="name"> -- имя комнаты </param>
+    room_t(std::string name) : name(std::move(name)), snapshot(std::make_shared<const snapshot_t>()), b_closed(false)
+    {}
+
+    /// <summary>
+    /// Метод публикации снимка текущего состава (вызывать под мьютексом комнаты после изменения members)
+    /// </summary>
+    void Publish()
+    {
+        std::atomic_store_explicit(&snapshot,
+            snapshot_p(std::make_shared<const snapshot_t>(members.begin(), members.end())), std::memory_order_release);
+    }
+
+    /// <summary>
+    /// Метод получения текущего снимка участников, мьютекс комнаты не нужен
+    /// </summary>
+    /// <returns> снимок (неизменяемый) </returns>
+    snapshot_p Snapshot() const
+    {
+        return std::atomic_load_explicit(&snapshot, std::memory_order_acquire);
+    }
+
+    const std::string name; // имя комнаты
+    std::mutex mutex; // мьютекс состава комнаты
+    slotMap_t<member_p> members; // участники (под мьютексом комнаты)
+    snapshot_p snapshot; // опубликованный снимок участников, доступ только через Publish()/Snapshot()
+
+    bool b_closed; // комната пуста и убрана из индекса, входить в нее нельзя (под мьютексом комнаты)
+};
+
+/// <summary>
+/// Индекс комнат по имени, разбитый на ROOM_SHARDS шардов со своими мьютексами.
+/// Порядок блокировок: мьютекс шарда -> мьютекс комнаты
+/// </summary>
+template<class Member>
+class roomIndex_t
+{
+public:
+    typedef std::shared_ptr<room_t<Member>> room_p;
+    typedef typename room_t<Member>::snapshot_p snapshot_p;
+
+    /// <summary>
+    /// Метод получения комнаты по имени, пустая комната создается.
+    /// Комната может закрыться до того, как вызывающий заблокирует ее мьютекс - проверяйте b_closed
+    /// </summary>
+    /// <param name="name"> - имя комнаты </param>
+    /// <returns> комната </returns>
+    room_p Get(std::string_view name)
+    {
+        shard_t& shard = shardOf(name);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::string key(name);
+        auto it = shard.m_room.find(key);
+        if (it != shard.m_room.end())
+            return it->second;
+        room_p room = std::make_shared<room_t<Member>>(key);
+        shard.m_room.emplace(std::move(key), room);
+        return room;
+    }
+
+    /// <summary>
+    /// Метод удаления комнаты из индекса, если в ней никого не осталось
+    /// </summary>
+    /// <param name="room"> - комната </param>
+    void Release(const room_p& room)
+    {
+        shard_t& shard = shardOf(room->name);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::lock_guard<std::mutex> lockRoom(room->mutex);
+        if (room->members.Empty() && !room->b_closed)
+        {
+            room->b_closed = true;
+            shard.m_room.erase(room->name);
+        }
+    }
+
+    /// <summary>
+    /// Метод вывода комнат в текстовом виде "room name=.. members=.."
+    /// </summary>
+    /// <param name="buf"> - буфер для вывода </param>
+    void Print(std::string& buf)
+    {
+        for (shard_t& shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto& it : shard.m_room)
+            {
+                std::lock_guard<std::mutex> lockRoom(it.second->mutex);
+                buf += "room name=" + (it.first.empty() ? std::string("<lobby>") : it.first)
+                    + " members=" + std::to_string(it.second->members.Size()) + '\n';
+            }
+        }
+    }
+private:
+    struct shard_t
+    {
+        std::mutex mutex; // мьютекс шарда
+        std::unordered_map<std::string, room_p> m_room; // комнаты шарда
+    };
+
+    shard_t& shardOf(std::string_view name)
+    {
+        return shards[std::hash<std::string_view>()(name) % ROOM_SHARDS];
+    }
+
+    shard_t shards[ROOM_SHARDS]; // шарды индекса
+};
+
+#endif /* ROOM_H_ */
@@ -0,0 +1,177 @@
+﻿#pragma once
+#ifndef SLOTMAP_H_
+#define SLOTMAP_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// дескриптор элемента slot map: номер слота + поколение.
+/// После удаления элемента поколение слота растет, старый дескриптор перестает совпадать
+/// </summary>
+struct slotHandle_t
+{
+    uint32_t index; // номер слота
+    uint32_t generation; // поколение слота на момент вставки (0 - пустой дескриптор)
+
+    slotHandle_t() : index(0), generation(0)
+    {}
+
+    bool operator==(const slotHandle_t& other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const slotHandle_t& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/// <summary>
+/// Slot map: значения лежат плотным массивом (перебор - линейный проход по непрерывной памяти),
+/// доступ по дескриптору и удаление за O(1), удаленный элемент замещается последним.
+/// Синхронизации нет, защита - на вызывающей стороне
+/// </summary>
+template<class T>
+class slotMap_t
+{
+public:
+    typedef typename std::vector<T>::iterator iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    slotMap_t() : freeHead(END)
+    {}
+
+    /// <summary>
+    /// Метод резервирования места под count элементов (без перераспределений до этого размера)
+    /// </summary>
+    /// <param name="count"> - количество элементов </param>
+    void Reserve(size_t count)
+    {
+        v_dense.reserve(count);
+        v_denseSlot.reserve(count);
+        v_slot.reserve(count);
+    }
+
+    /// <summary>
+    /// Метод вставки элемента
+    /// </summary>
+    /// <param name="value"> - значение </param>
+    /// <returns> дескриптор элемента </returns>
+    slotHandle_t Insert(const T& value)
+    {
+        uint32_t index = freeHead;
+        if (index == END)
+        { // свободных слотов нет - новый слот
+            index = static_cast<uint32_t>(v_slot.size());
+            v_slot.push_back(slot_t{ 0, 1 });
+        }
+        else
+            freeHead = v_slot[index].dense; // у свободного слота dense - ссылка на следующий свободный
+
+        v_slot[index].dense = static_cast<uint32_t>(v_dense.size());
+        v_dense.push_back(value);
+        v_denseSlot.push_back(index);
+
+        slotHandle_t handle;
+        handle.index = index;
+        handle.generation = v_slot[index].generation;
+        return handle;
+    }
+
+    /// <summary>
+    /// Метод удаления элемента: на его место в плотном массиве переезжает последний
+    /// </summary>
+    /// <param name="handle"> - дескриптор элемента </param>
+    /// <returns> 1 - элемент удален; 0 - дескриптор устарел </returns>
+    bool Erase(slotHandle_t handle)
+    {
+        if (!Valid(handle))
+            return false;
+
+        uint32_t dense = v_slot[handle.index].dense;
+        uint32_t last = static_cast<uint32_t>(v_dense.size() - 1);
+        if (dense != last)
+        {
+            v_dense[dense] = v_dense[last];
+            v_denseSlot[dense] = v_denseSlot[last];
+            v_slot[v_denseSlot[dense]].dense = dense;
+        }
+        v_dense.pop_back();
+        v_denseSlot.pop_back();
+
+        slot_t& slot = v_slot[handle.index];
+        if (++slot.generation == 0) // поколение 0 зарезервировано за пустым дескриптором
+            slot.generation = 1;
+        slot.dense = freeHead;
+        freeHead = handle.index;
+        return true;
+    }
+
+    /// <summary>
+    /// Метод проверки дескриптора
+    /// </summary>
+    /// <param name="handle"> - дескриптор </param>
+    /// <returns> 1 - элемент существует </returns>
+    bool Valid(slotHandle_t handle) const
+    {
+        return handle.generation != 0 && handle.index < v_slot.size() && v_slot[handle.index].generation == handle.generation;
+    }
+
+    /// <summary>
+    /// Метод доступа к элементу по дескриптору
+    /// </summary>
+    /// <param name="handle"> - дескриптор </param>
+    /// <returns> указатель на значение, nullptr - дескриптор устарел. Указатель валиден до следующего изменения </returns>
+    T* Get(slotHandle_t handle)
+    {
+        return Valid(handle) ? &v_dense[v_slot[handle.index].dense] : nullptr;
+    }
+
+    /// <summary>
+    /// Метод удаления всех элементов (все выданные дескрипторы устаревают)
+    /// </summary>
+    void Clear()
+    {
+        while (!v_denseSlot.empty())
+        {
+            slotHandle_t handle;
+            handle.index = v_denseSlot.back();
+            handle.generation = v_slot[handle.index].generation;
+            Erase(handle);
+        }
+    }
+
+    size_t Size() const
+    {
+        return v_dense.size();
+    }
+
+    bool Empty() const
+    {
+        return v_dense.empty();
+    }
+
+    // перебор значений в плотном массиве (порядок меняется при удалении)
+    iterator begin() { return v_dense.begin(); }
+    iterator end() { return v_dense.end(); }
+    const_iterator begin() const { return v_dense.begin(); }
+    const_iterator end() const { return v_dense.end(); }
+private:
+    static const uint32_t END = 0xFFFFFFFF; // конец списка свободных слотов
+
+    struct slot_t
+    {
+        uint32_t dense; // занятый слот - индекс в плотном массиве; свободный - следующий свободный слот
+        uint32_t generation; // поколение слота
+    };
+
+    std::vector<T> v_dense; // значения подряд
+    std::vector<uint32_t> v_denseSlot; // слот каждого значения плотного массива
+    std::vector<slot_t> v_slot; // слоты
+    uint32_t freeHead; // первый свободный слот
+};
+
+#endif /* SLOTMAP_H_ */
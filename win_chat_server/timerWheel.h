@@ -0,0 +1,99 @@
+﻿#pragma once
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include <vector>
+#include <cstddef>
+
+/// <summary>
+/// Колесо таймеров: срок округляется до шага (tick), таймер попадает в слот своего шага по модулю размера колеса.
+/// Постановка - O(1), продвижение - по слотам прошедших шагов; срок дальше оборота колеса ждет в слоте нужного оборота.
+/// Отмены нет: владелец при срабатывании сам проверяет, актуален ли таймер (ленивая перепостановка).
+/// Синхронизации нет, защита - на вызывающей стороне
+/// </summary>
+template<class T>
+class timerWheel_t
+{
+public:
+    /// <summary>
+    /// конструктор
+    /// </summary>
+    /// <param name="slots"> - слотов в колесе </param>
+    /// <param name="tick"> - шаг колеса, мкс </param>
+    /// <param name="now"> - текущее время, мкс </param>
+    timerWheel_t(size_t slots, unsigned long long tick, unsigned long long now) :
+        v_slot(slots), tick(tick), current(now / tick), count(0)
+    {}
+
+    /// <summary>
+    /// Метод постановки таймера
+    /// </summary>
+    /// <param name="value"> - значение, возвращаемое при срабатывании </param>
+    /// <param name="deadline"> - срок, мкс (прошедший срок срабатывает на следующем шаге) </param>
+    void Schedule(const T& value, unsigned long long deadline)
+    {
+        unsigned long long at = deadline / tick;
+        if (at <= current)
+            at = current + 1;
+        v_slot[at % v_slot.size()].push_back(timer_t{ value, at });
+        ++count;
+    }
+
+    /// <summary>
+    /// Метод продвижения колеса до текущего времени. Сработавшие таймеры снимаются с колеса до вызова fire,
+    /// так что fire может ставить таймеры заново
+    /// </summary>
+    /// <param name="now"> - текущее время, мкс </param>
+    /// <param name="fire"> - обработчик сработавшего таймера fire(value) </param>
+    template<class Fire>
+    void Advance(unsigned long long now, Fire fire)
+    {
+        unsigned long long target = now / tick;
+        if (target <= current)
+            return;
+        // за одно продвижение каждый слот смотрим не больше раза, даже после долгой паузы
+        unsigned long long steps = target - current < v_slot.size() ? target - current : v_slot.size();
+        for (unsigned long long step = 1; step <= steps; ++step)
+        {
+            std::vector<timer_t>& slot = v_slot[(current + step) % v_slot.size()];
+            for (size_t i = 0; i < slot.size(); )
+                if (slot[i].at <= target)
+                {
+                    v_fired.push_back(slot[i].value);
+                    slot[i] = slot.back();
+                    slot.pop_back();
+                }
+                else
+                    ++i;
+        }
+        current = target;
+
+        count -= v_fired.size();
+        for (const T& value : v_fired)
+            fire(value);
+        v_fired.clear();
+    }
+
+    /// <summary>
+    /// Метод возврата количества стоящих таймеров
+    /// </summary>
+    /// <returns> таймеров на колесе </returns>
+    size_t Size() const
+    {
+        return count;
+    }
+private:
+    struct timer_t
+    {
+        T value; // значение таймера
+        unsigned long long at; // шаг срабатывания
+    };
+
+    std::vector<std::vector<timer_t>> v_slot; // слоты колеса
+    std::vector<T> v_fired; // сработавшие за одно продвижение (буфер переиспользуется)
+    const unsigned long long tick; // шаг колеса, мкс
+    unsigned long long current; // последний обработанный шаг
+    size_t count; // таймеров на колесе
+};
+
+#endif /* TIMERWHEEL_H_ */
@@ -0,0 +1,58 @@
+﻿#pragma once
+#ifndef TOKENBUCKET_H_
+#define TOKENBUCKET_H_
+
+/// <summary>
+/// бакет токенов: запас пополняется со скоростью rate в секунду до емкости burst.
+/// Скорость и емкость хранит владелец (бакетов много - например, по одному на адрес), время - в микросекундах.
+/// Запас может уйти в минус (долг): так списывается кадр крупнее остатка, а владелец ждет погашения долга
+/// </summary>
+struct tokenBucket_t
+{
+    double tokens; // текущий запас (отрицательный - долг)
+    unsigned long long stamp; // время последнего пополнения, мкс
+
+    /// <summary>
+    /// Метод сброса: полный бакет
+    /// </summary>
+    /// <param name="burst"> - емкость </param>
+    /// <param name="now"> - текущее время, мкс </param>
+    void Reset(double burst, unsigned long long now)
+    {
+        tokens = burst;
+        stamp = now;
+    }
+
+    /// <summary>
+    /// Метод пополнения на текущее время
+    /// </summary>
+    /// <param name="rate"> - скорость пополнения, в секунду </param>
+    /// <param name="burst"> - емкость </param>
+    /// <param name="now"> - текущее время, мкс </param>
+    /// <returns> запас после пополнения </returns>
+    double Refill(double rate, double burst, unsigned long long now)
+    {
+        if (now > stamp)
+        {
+            tokens += static_cast<double>(now - stamp) * rate / 1000000.0;
+            if (tokens > burst)
+                tokens = burst;
+            stamp = now;
+        }
+        return tokens;
+    }
+
+    /// <summary>
+    /// Метод расчета времени до погашения долга
+    /// </summary>
+    /// <param name="rate"> - скорость пополнения, в секунду (0 - долг не гасится, ответ 0) </param>
+    /// <returns> ожидание, мкс (0 - долга нет) </returns>
+    unsigned long long Debt(double rate) const
+    {
+        if (tokens >= 0.0 || rate <= 0.0)
+            return 0;
+        return static_cast<unsigned long long>(-tokens * 1000000.0 / rate) + 1;
+    }
+};
+
+#endif /* TOKENBUCKET_H_ */
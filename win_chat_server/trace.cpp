@@ -0,0 +1,85 @@
+﻿#include "trace.h"
+
+/// <summary>
+/// Конструктор
+/// </summary>
+/// <param name="logger"> - ссылка на обект логгирования </param>
+trace_t::trace_t(log_t& logger) : logger(logger), b_first(true), sampleRate(0), counter(0)
+{}
+
+/// <summary>
+/// Деструктор, закрывает массив событий в файле
+/// </summary>
+trace_t::~trace_t()
+{
+    if (traceFile.is_open())
+    {
+        traceFile << "\n]\n";
+        traceFile.close();
+    }
+}
+
+/// <summary>
+/// Метод открытия файла трассы
+/// </summary>
+/// <param name="nameFile"> - имя файла трассы (перезаписывается) </param>
+/// <param name="sampleRate"> - трассируем каждое sampleRate-ое сообщение (0 - трасса выключена) </param>
+/// <returns> 1 - трасса включена </returns>
+bool trace_t::Open(const std::string& nameFile, unsigned sampleRate)
+{
+    if (sampleRate == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    traceFile.open(nameFile.c_str(), std::ios::trunc);
+    if (!traceFile)
+    {
+        logger.doLog("trace_t::Open - fail open file " + nameFile);
+        return false;
+    }
+
+    traceFile << "[\n";
+    b_first = true;
+    this->sampleRate = sampleRate;
+    logger.doLog("trace_t::Open - tracing 1 of " + std::to_string(sampleRate) + " messages to " + nameFile);
+    return true;
+}
+
+/// <summary>
+/// Метод выборки: нужно ли трассировать очередное сообщение
+/// </summary>
+/// <returns> 1 - сообщение попало в выборку </returns>
+bool trace_t::Sample()
+{
+    if (sampleRate == 0)
+        return false;
+    return counter.fetch_add(1, std::memory_order_relaxed) % sampleRate == 0;
+}
+
+/// <summary>
+/// Метод записи события этапа
+/// </summary>
+/// <param name="name"> - имя этапа </param>
+/// <param name="tid"> - номер дорожки (номер соединения) </param>
+/// <param name="start"> - начало этапа, мкс </param>
+/// <param name="end"> - конец этапа, мкс </param>
+/// <param name="to"> - номер соединения получателя (0 - не указывать) </param>
+void trace_t::Event(const char* name, unsigned long long tid, unsigned long long start, unsigned long long end, unsigned long long to)
+{
+    // готовим событие вне блокировки
+    std::string event = "{\"name\":\"";
+    event += name;
+    event += "\",\"cat\":\"msg\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(tid)
+        + ",\"ts\":" + std::to_string(start) + ",\"dur\":" + std::to_string(end - start);
+    if (to != 0)
+        event += ",\"args\":{\"to\":" + std::to_string(to) + '}';
+    event += '}';
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!traceFile.is_open())
+        return;
+    if (!b_first) // события разделяются запятой
+        traceFile << ",\n";
+    b_first = false;
+    traceFile << event;
+}
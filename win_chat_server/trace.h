@@ -0,0 +1,62 @@
+﻿#pragma once
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <atomic>
+#include <string>
+#include <fstream>
+#include <mutex>
+
+#include "log.h"
+
+/// <summary>
+/// Запись выборочной трассы прохождения сообщений в файл формата Chrome trace (chrome://tracing, Perfetto).
+/// Каждое N-ое сообщение раскладывается на этапы, этапы пишутся как события "X" (начало + длительность)
+/// </summary>
+class trace_t
+{
+public:
+    /// <summary>
+    /// Конструктор
+    /// </summary>
+    /// <param name="logger"> - ссылка на обект логгирования </param>
+    trace_t(log_t& logger);
+
+    /// <summary>
+    /// Деструктор, закрывает массив событий в файле
+    /// </summary>
+    ~trace_t();
+
+    /// <summary>
+    /// Метод открытия файла трассы
+    /// </summary>
+    /// <param name="nameFile"> - имя файла трассы (перезаписывается) </param>
+    /// <param name="sampleRate"> - трассируем каждое sampleRate-ое сообщение (0 - трасса выключена) </param>
+    /// <returns> 1 - трасса включена </returns>
+    bool Open(const std::string& nameFile, unsigned sampleRate);
+
+    /// <summary>
+    /// Метод выборки: нужно ли трассировать очередное сообщение
+    /// </summary>
+    /// <returns> 1 - сообщение попало в выборку </returns>
+    bool Sample();
+
+    /// <summary>
+    /// Метод записи события этапа
+    /// </summary>
+    /// <param name="name"> - имя этапа </param>
+    /// <param name="tid"> - номер дорожки (номер соединения) </param>
+    /// <param name="start"> - начало этапа, мкс </param>
+    /// <param name="end"> - конец этапа, мкс </param>
+    /// <param name="to"> - номер соединения получателя (0 - не указывать) </param>
+    void Event(const char* name, unsigned long long tid, unsigned long long start, unsigned long long end, unsigned long long to = 0);
+protected:
+    log_t& logger; // ссылка на обект логгирования
+    std::ofstream traceFile; // файл трассы
+    std::mutex mutex; // защита записи в файл
+    bool b_first; // флаг первого события в массиве (для расстановки запятых)
+    unsigned sampleRate; // трассируем каждое sampleRate-ое сообщение
+    std::atomic<unsigned long long> counter; // счетчик сообщений для выборки
+};
+
+#endif /* TRACE_H_ */
@@ -4,283 +4,838 @@
 #include <mutex>
 #include <list>
 #include <condition_variable>
+#include <unordered_map>
+#include <memory_resource>
+#include <charconv>
+#include <csignal>
 
 #include "network.h"
 #include "poolThread.h"
+#include "metrics.h"
+#include "trace.h"
+#include "msg.h"
+#include "memPool.h"
+#include "slotMap.h"
+#include "room.h"
+#include "config.h"
+#include "admission.h"
+#include "tokenBucket.h"
+#include "timerWheel.h"
+#include "handoff.h"
+#include "history.h"
 
-#define IP_ADRES "127.0.0.1"
-#define MAX_COUNT_CLIENT 2
+#ifndef __WIN32__
+#include <pthread.h>
+#endif
+
+#define TRACE_FILE "server.trace.json"
+#define ACCEPT_RETRY_MS 10 // пауза перед повтором приема, когда кончились дескрипторы, мс
+#define SESSION_THROTTLE_SLICE_US 50000ull // шаг сна сессии, ждущей погашения входящего бюджета, мкс
+#define HEARTBEAT_TICK_MS 100 // шаг колеса таймеров проверки связи, мс
+#define HEARTBEAT_SLOTS 1024 // слотов колеса таймеров (оборот - HEARTBEAT_SLOTS * HEARTBEAT_TICK_MS)
+#define DRAIN_POLL_MS 10 // шаг ожидания отключения собеседников при плавной остановке, мс
+#define SESSION_HANDOVER_POLL_MS 1 // шаг ожидания затихшей сессией разрешения отдать сокет преемнику, мс
+#define SESSION_REPLAY_QUEUE (1 << 16) // живых кадров, копящихся у сессии на время показа истории, байт (больше - разрыв)
+#define SESSION_PREALLOC_SLACK 32 // блок управления allocate_shared (vptr, два счетчика, аллокатор) при резервировании пула сессий, байт
+
+/// <summary>
+/// статистика соединения, которую сессия публикует для административного интерфейса.
+/// Сессия обновляет атомарные поля без блокировок, интерфейс читает их, не трогая мьютекс чата
+/// </summary>
+struct sessionStat_t
+{
+    /// <summary>
+    /// конструктор
+    /// </summary>
+    /// <param name="id"> -- номер соединения </param>
+    /// <param name="peer"> -- адрес клиента в двоичном виде </param>
+    sessionStat_t(unsigned long long id, const network::endpoint_t& peer) :
+        id(id), peer(peer), start(metrics_t::Now()), active(false), msgIn(0), msgOut(0), bytesIn(0), bytesOut(0), throttled(0),
+        lastRecv(start), sendStart(0), pinged(false)
+    {}
+
+    const unsigned long long id; // номер соединения
+    const network::endpoint_t peer; // адрес клиента (строка формируется только для отчета)
+    const unsigned long long start; // время подключения, мкс
+    std::atomic_bool active; // сессия получила поток пула (иначе ждет в очереди)
+    std::atomic<unsigned long long> msgIn; // принято сообщений
+    std::atomic<unsigned long long> msgOut; // отправлено сообщений собеседникам
+    std::atomic<unsigned long long> bytesIn; // принято байт
+    std::atomic<unsigned long long> bytesOut; // отправлено байт собеседникам
+    std::atomic<unsigned long long> throttled; // раз сессия ждала погашения входящего бюджета
+    std::atomic<unsigned long long> lastRecv; // время последнего принятого кадра, мкс
+    std::atomic<unsigned long long> sendStart; // начало текущей записи в сокет собеседника, мкс (0 - запись не идет)
+    std::atomic_bool pinged; // собеседнику отправлен [PING], ответа (любого кадра) еще нет
+};
+
+/// <summary>
+/// метрики сессий: ссылки в реестр метрик разрешаются один раз в менеджере чата,
+/// сессия при подключении не ищет метрики по именам
+/// </summary>
+struct sessionMetrics_t
+{
+    /// <summary>
+    /// конструктор
+    /// </summary>
+    /// <param name="metrics"> -- ссылка на реестр метрик </param>
+    sessionMetrics_t(metrics_t& metrics) :
+        msgIn(metrics.Counter("session.msg_in")), msgOut(metrics.Counter("session.msg_out")), bytesIn(metrics.Counter("session.bytes_in")),
+        bytesOut(metrics.Counter("session.bytes_out")), privateMsg(metrics.Counter("session.msg_private")),
+        fanoutTime(metrics.Histogram("session.broadcast_us")), clients(metrics.Gauge("chat.clients")),
+        parseTime(metrics.Histogram("msg.parse_us")), lockWait(metrics.Histogram("msg.lock_wait_us")),
+        fanoutWait(metrics.Histogram("msg.fanout_wait_us")), sendTime(metrics.Histogram("msg.send_us")),
+        deliverTime(metrics.Histogram("msg.deliver_us")), throttled(metrics.Counter("session.throttled")),
+        throttleTime(metrics.Histogram("session.throttle_us")), replayed(metrics.Counter("session.history_replayed")),
+        replayTime(metrics.Histogram("session.history_replay_us"))
+    {}
+
+    counter_t& msgIn; // метрика: принято сообщений от клиентов
+    counter_t& msgOut; // метрика: доставлено сообщений собеседникам
+    counter_t& bytesIn; // метрика: принято байт
+    counter_t& bytesOut; // метрика: доставлено байт
+    counter_t& privateMsg; // метрика: личных сообщений
+    histogram_t& fanoutTime; // метрика: время рассылки сообщения собеседникам, мкс
+    gauge_t& clients; // метрика: текущее количество собеседников
+    histogram_t& parseTime; // метрика: прием -> разбор заголовка, мкс
+    histogram_t& lockWait; // метрика: разбор -> маршрут получен (снимок комнаты / индекс под мьютексом чата), мкс
+    histogram_t& fanoutWait; // метрика: ожидание своей очереди в рассылке (за предыдущими получателями), мкс
+    histogram_t& sendTime; // метрика: запись в сокет одного получателя, мкс
+    histogram_t& deliverTime; // метрика: прием -> запись в сокет получателя, мкс
+    counter_t& throttled; // метрика: раз сессии ждали погашения входящего бюджета
+    histogram_t& throttleTime; // метрика: ожидание погашения входящего бюджета
+    counter_t& replayed; // метрика: сообщений истории показано при входе в комнату
+    histogram_t& replayTime; // метрика: показ истории при входе в комнату, мкс
+};
+
+/// <summary>
+/// статистика соединений для административного интерфейса: сессия вносит себя при создании
+/// и выписывается при закрытии, перебор - линейный проход без просеивания устаревших записей
+/// </summary>
+struct statTable_t
+{
+    slotMap_t<std::shared_ptr<sessionStat_t>> stats; // статистика живых соединений
+    std::mutex mutex; // мьютекс защиты статистики (берется после мьютекса чата, сам мьютекс чата не держит)
+};
 
 /// <summary>
-/// тип сообщений
+/// передача соединений новому процессу: общее состояние менеджера чата и сессий
 /// </summary>
-enum TypeMsg
+struct handover_t
 {
-    defaul, // неопознанное
-    normal, // нормальное, с полезной нагрузкой
-    // сервисные:
-    Exit, // отключение клиента
-    shutDown, // отключение сервера
-    linkOn, // собеседники на связи
-    printinfo // вывод информации по соединению
+    handover_t() : b_requested(false), b_release(false)
+    {}
+
+    volatile std::atomic_bool b_requested; // преемник подключился: сессии дорабатывают текущий кадр и перестают читать
+    volatile std::atomic_bool b_release; // рассылок больше нет: сессии отдают сокеты и хвосты приема
+    handoffState_t state; // отданные сессии (под мьютексом чата)
 };
 
+class session_t;
+typedef slotMap_t<session_t*> registry_t; // реестр собеседников: плотный массив указателей, защищен мьютексом чата
+typedef roomIndex_t<session_t> rooms_t; // индекс комнат
+typedef std::unordered_map<unsigned long long, slotHandle_t> sessionIndex_t; // номер соединения -> дескриптор в реестре, защищен мьютексом чата
+
 /// <summary>
-/// класс декоратор над std::string для хранения сообщения, состоящего из 
-/// заголовка (тип сообщения)-6 символов + текст + конец сообщения(EOM)-5 символов
+/// Класс по обработке клиентского соединения в отдельном потоке (пуле потоков).
+/// реализован на синхронных сокетах (предполагается, что ацептор также синхронен) 
 /// </summary>
-class msg_t
+class session_t : public ABStask, public network::TCP_socketClient_t, public std::enable_shared_from_this<session_t>
 {
 public:
     /// <summary>
-    /// контсруктор
+    /// конструктор
     /// </summary>
-    /// <param name="type"> -- тип сообщения</param>
-    /// <param name="text"> -- текст сообщения</param>
-    msg_t(TypeMsg type = TypeMsg::defaul, std::string text = "") : offset(0)
+    /// <param name="registry"> -- ссылка на реестр собеседников, сессия регистрируется в нем сама (вызывать под мьютексом) </param>
+    /// <param name="index"> -- ссылка на индекс номер соединения -> дескриптор в реестре, сессия вносит себя сама </param>
+    /// <param name="mutex"> -- ссылка на мьютекс, защищаюйщий реестр и индекс собеседников </param>
+    /// <param name="rooms"> -- ссылка на индекс комнат </param>
+    /// <param name="sessionPool"> -- ссылка на пул сессий, из него берется начальный блок арены </param>
+    /// <param name="config"> -- параметры сервера </param>
+    /// <param name="admission"> -- ссылка на допуск подключений, сессия снимает свое подключение с учета при разрушении </param>
+    /// <param name="client"> -- ссылка на клиентский сокет, полученный ацептором </param>
+    /// <param name="wakeup"> -- событие остановки приема, [SHUT] взводит его для ацептора </param>
+    /// <param name="b_shutDown"> -- ссылка на флаг отключения сервера </param>
+    /// <param name="handover"> -- ссылка на состояние передачи соединений новому процессу </param>
+    /// <param name="resumed"> -- сессия, принятая от прошлого процесса (nullptr - новое подключение) </param>
+    /// <param name="metric"> -- ссылка на метрики сессий, разрешенные менеджером чата один раз </param>
+    /// <param name="stat"> -- статистика соединения для административного интерфейса </param>
+    /// <param name="statTable"> -- ссылка на таблицу статистики, сессия вносит в нее себя сама </param>
+    /// <param name="trace"> -- ссылка на трассу сообщений </param>
+    /// <param name="history"> -- ссылка на журнал истории комнат </param>
+    /// <param name="logger"> -- ссылка на обект логгирования </param>
+    session_t(registry_t& registry, sessionIndex_t& index,
+        std::mutex& mutex, rooms_t& rooms, memPool_t& sessionPool, const config_t& config, admission_t& admission,
+        network::TCP_socketClient_t& client,
+        network::wakeup_t& wakeup,
+        volatile std::atomic_bool& b_shutDown,
+        handover_t& handover,
+        const handoffSession_t* resumed,
+        sessionMetrics_t& metric,
+        std::shared_ptr<sessionStat_t> stat,
+        statTable_t& statTable,
+        trace_t& trace,
+        history_t& history,
+        log_t& logger) :
+        network::TCP_socketClient_t(logger), registry(registry), index(index), mutex(mutex), rooms(rooms), b_replaying(false),
+        msg_RX(TypeMsg::linkOn), wakeup(wakeup), b_shutDown(b_shutDown), b_drained(false), handover(handover), b_quiet(false),
+        b_resumed(resumed != nullptr), stat(stat), statTable(statTable), trace(trace), history(history), metric(metric),
+        sessionPool(sessionPool), arenaSize(config.sessionArena), arenaBuf(sessionPool.Allocate(arenaSize)), arena(arenaBuf, arenaSize),
+        admission(admission), msgRate(config.msgRate), msgBurst(config.msgBurst), byteRate(config.byteRate), byteBurst(config.byteBurst),
+        p_stop(nullptr), historyReplay(config.historyReplay)
     {
-        switch (type)
+        unsigned long long now = metrics_t::Now();
+        msgBudget.Reset(msgBurst, now);
+        byteBudget.Reset(byteBurst, now);
+        Move(client); // кастомная (самодельная) move семантика
+        if (b_resumed)
+        { // кадровое состояние приема и комната - от прошлого процесса
+            Preload(resumed->pending);
+            resumeRoom = resumed->room;
+        }
+        handle = registry.Insert(this);
+        index[stat->id] = handle;
         {
-        case normal:
-            this->text = "[NORM]" + text + "[EOM]"; // полезная нагрузка лишь здесь
-            break;
-        case Exit:
-            this->text = "[EXIT][EOM]";
-            break;
-        case shutDown:
-            this->text = "[SHUT][EOM]";
-            break;
-        case linkOn:
-            this->text = "[LINK][EOM]";
-            break;
-        case printinfo:
-            this->text = "[INFO][EOM]"; 
-            break;
-        default:
-            break;
+            std::lock_guard<std::mutex> lockStat(statTable.mutex);
+            statHandle = statTable.stats.Insert(stat);
+        }
+        b_connected = GetConnected();
+        // кадры рассылаются по одному: в профиле чата без Нейгла второй кадр не ждет ACK первого
+        ApplyProfile(*network::sockProfile_t::Find(config.socketProfile));
+    }
+
+    // деструктор
+    ~session_t()
+    {
+        dropStat(); // сессия, которую пул так и не запустил, выписывается здесь
+        arena.release(); // начальный блок арена не трогает, возвращаем его в пул
+        sessionPool.Free(arenaBuf, arenaSize);
+        admission.Release(stat->peer);
+    }
+
+    /// <summary>
+    /// потоковый метод работы, запускается в отдельном потоке в пуле потоков 
+    /// </summary>
+    /// <param name="stop"> -- флаг остановки задачи от пула потоков </param>
+    void Work(const volatile std::atomic_bool& stop) override
+    {
+        bool b_firstIter = true; // флаг первой итерации цикла
+        p_stop = &stop; // для учета байт в onRecive()
+#ifndef __WIN32__
+        thread = pthread_self(); // для Interrupt(), публикуется записью active
+#endif
+        stat->active = true;
+        do // начинаем с рукопожатия
+        {
+            bool b_traced = false; // сообщение попало в выборку трассы
+            if (!b_firstIter) // первое сообщение - внутреннее рукопожатие, его не считаем
+            {
+                // Recive() только что вернул целое сообщение: любой кадр - признак живого собеседника
+                stat->lastRecv.store(msg_RX.Stamp(StageMsg::recived), std::memory_order_relaxed);
+                stat->pinged.store(false, std::memory_order_relaxed);
+                b_traced = trace.Sample();
+                metric.msgIn.Add();
+                metric.bytesIn.Add(msg_RX.Str().size());
+                stat->msgIn.fetch_add(1, std::memory_order_relaxed);
+                stat->bytesIn.fetch_add(msg_RX.Str().size(), std::memory_order_relaxed);
+                throttle(stop); // байты уже учтены по мере чтения в onRecive()
+            }
+            TypeMsg type = msg_RX.Decode(); // разбираем заголовок один раз на кадр
+
+            msg_RX.Stamp(StageMsg::parsed);
+            //std::cout << "IN: " << msg_RX.Str() << '\n'; ////////////////////////////////наладка
+            // обновляем флаги
+            b_connected &= GetConnected() && type != TypeMsg::Exit;
+            b_shutDown = b_shutDown || type == TypeMsg::shutDown;
+
+            if (b_firstIter && b_resumed) // соединение от прошлого процесса: собеседники уже знакомы, входим молча
+                enterRoom(resumeRoom, false);
+            else if (b_firstIter) // рукопожатие: входим в общую комнату, ее участники получают [LINK]
+            {
+                enterRoom(ROOM_LOBBY);
+                std::pmr::string text("SYSTEM MSG: your id ", &arena); // номер для личных сообщений [PRIV]<id> <текст>
+                appendNumber(text, stat->id);
+                sendNotice(TypeMsg::normal, text);
+            }
+            else if (type == TypeMsg::join)
+            {
+                std::string_view name = msg_RX.Payload();
+                if (name.empty() || name.size() > ROOM_NAME_MAX)
+                    sendNotice(TypeMsg::normal, "SYSTEM MSG: invalid room name");
+                else
+                {
+                    leaveRoom(true);
+                    enterRoom(name);
+                }
+            }
+            else if (type == TypeMsg::leave)
+            {
+                leaveRoom(true);
+                enterRoom(ROOM_LOBBY);
+            }
+            else if (type == TypeMsg::priv)
+                sendPrivate(b_traced);
+            else if (type == TypeMsg::ping)
+                sendNotice(TypeMsg::pong);
+            else if (type == TypeMsg::pong)
+                ; // ответ на нашу проверку связи: время приема уже обновлено
+            else
+                broadcast(type, b_traced);
+            b_firstIter = false;
+
+            // если сервер отключается из-за нас
+            if (b_shutDown && type == TypeMsg::shutDown)
+            {
+                sendNotice(TypeMsg::normal, "SYSTEM MSG: server shutdown"); // подтверждаем клиенту свое отключение
+                wakeup.Signal(); // будим ацептор в главном потоке
+                break; // выходим
+            }
+            arena.release(); // временные объекты сообщения больше не нужны, арена снова пуста
+            // крутимся пока нет остановки и есть связь, и мы приняли сообщение, и нет отключения сервера
+        } while (!stop && b_connected && !handover.b_requested && 0 == recive() && !b_shutDown);
+
+        bool b_handover = handover.b_requested && b_connected && GetConnected();
+        if (b_handover)
+        { // передача новому процессу: ждем, пока перестанут читать все, - тогда рассылок к нам больше не будет
+            b_quiet = true;
+            while (!handover.b_release && !stop)
+                std::this_thread::sleep_for(std::chrono::milliseconds(SESSION_HANDOVER_POLL_MS));
+        }
+        std::string roomName = room ? room->name : std::string();
+        leaveRoom(false); // выход молча, как и раньше: о разрыве собеседники узнают сами
+        // логгируем активность
+        std::lock_guard<std::mutex> lock(mutex);
+        if (registry.Erase(handle)) // выписываемся из реестра (дескриптор мог устареть, если чат уже закрылся)
+            index.erase(stat->id);
+        dropStat();
+        if (b_handover)
+        { // сокет и непрочитанный хвост уходят преемнику, соединение не рвем
+            handoffSession_t parked{ INVALID_SOCKET, stat->id, std::move(roomName), std::string(Pending()) };
+            std::lock_guard<std::mutex> lockSend(mtx_send); // личное сообщение могло взять нас до выписки и еще писать
+            parked.socket = Detach();
+            handover.state.v_session.push_back(std::move(parked));
         }
+        // вывод в лог
+        metric.clients.Set(registry.Size());
+        logger.doLog("Close client, count client: " + std::to_string(registry.Size()));
     }
 
     /// <summary>
-    /// метод получения не константной ссылки на внутренний std::string с сообщением
+    /// метод проверки связи из потока проверки связи: кадр [PING] уходит без ожидания,
+    /// если сокет сейчас не занят записью (зависшую запись ловит таймаут записи)
     /// </summary>
-    /// <returns> не константная ссылка на внутренний std::string с сообщением </returns>
-    std::string& Update()
+    /// <returns> результат SendNow(); -4 - идет запись, проверка отложена </returns>
+    int Ping()
     {
-        offset = 0;
-        return text;
+        std::unique_lock<std::mutex> lock(mtx_send, std::try_to_lock);
+        if (!lock.owns_lock() || b_replaying) // показ истории пишет в сокет без мьютекса
+            return -4;
+        static const std::string ping = msg_t(TypeMsg::ping).Str();
+        return SendNow(ping);
     }
 
     /// <summary>
-    /// метод получения константной ссылки на внутренний std::string с сообщением 
+    /// метод уведомления клиента при плавной остановке (вызывать под мьютексом чата): кадр уходит без ожидания
+    /// следом за начатой записью, затем запись закрывается - клиент дочитывает все отправленное и видит конец потока,
+    /// а сессия, не бросая прием, дожидается его отключения
     /// </summary>
-    /// <returns> константная ссылка на внутренний std::string с сообщением </returns>
-    const std::string& Str() const
+    /// <param name="notice"> -- кадр уведомления </param>
+    /// <returns> 1 - клиент уведомлен либо уведомить уже нельзя; 0 - сокет занят записью, повторить позже </returns>
+    bool Drain(std::string_view notice)
     {
-        return text;
+        if (b_drained)
+            return true;
+        std::unique_lock<std::mutex> lock(mtx_send, std::try_to_lock);
+        if (!lock.owns_lock() || b_replaying || SendNow(notice) == -3)
+            return false;
+        ShutdownSend();
+        b_drained = true;
+        return true;
     }
 
     /// <summary>
-    /// метод получения типа сообщения
+    /// метод прерывания ожидания приема в потоке сессии (передача новому процессу): recv вернет EINTR.
+    /// Сигнал мог прийти до входа в recv - вызывать повторно, пока сессия не затихнет (вызывать под мьютексом чата)
     /// </summary>
-    /// <returns> типа сообщения </returns>
-    TypeMsg Type() const
+    /// <param name="sig"> -- сигнал прерывания (0 - не поддерживается) </param>
+    void Interrupt(int sig)
     {
-        TypeMsg result = TypeMsg::defaul;
+#ifndef __WIN32__
+        if (sig != 0 && stat->active) // поток пула занят сессией, пока она в реестре
+            pthread_kill(thread, sig);
+#endif
+    }
 
-        if (text.size() >= 6)
-        {
-            std::string header(text, 0, 6); // извлекаем заголовок
-            if (header == "[NORM]")
-                result = TypeMsg::normal;
-            else if (header == "[EXIT]")
-                result = TypeMsg::Exit;
-            else if (header == "[SHUT]")
-                result = TypeMsg::shutDown;
-            else if (header == "[LINK]")
-                result = TypeMsg::linkOn;
-            else if (header == "[INFO]")
-                result = TypeMsg::printinfo;
-        }
+    /// <summary>
+    /// метод проверки затихания при передаче новому процессу
+    /// </summary>
+    /// <returns> 1 - сессия больше не читает и не рассылает, ждет разрешения отдать сокет </returns>
+    bool Quiet() const
+    {
+        return b_quiet;
+    }
 
+    /// <summary>
+    /// метод доступа к статистике соединения
+    /// </summary>
+    /// <returns> статистика соединения </returns>
+    sessionStat_t& Stat()
+    {
+        return *stat;
+    }
+protected:
+    /// <summary>
+    /// метод учета входящего бюджета сообщений: принятый кадр списывается с бюджета сообщений.
+    /// Пока долг не погашен, сессия не читает сокет и не рассылает: ее поток спит, сообщения остальных идут без очереди
+    /// за флудером, а сам флудер упирается в окно TCP (дефицитная схема с квантом, пропорциональным времени)
+    /// </summary>
+    /// <param name="stop"> -- флаг остановки задачи от пула потоков </param>
+    void throttle(const volatile std::atomic_bool& stop)
+    {
+        if (msgRate == 0)
+            return;
+        unsigned long long now = metrics_t::Now();
+        msgBudget.Refill(msgRate, msgBurst, now);
+        msgBudget.tokens -= 1.0;
+        waitDebt(msgBudget.Debt(msgRate), now, stop);
+    }
+
+    /// <summary>
+    /// метод учета входящего бюджета байт на каждое чтение из сокета, до сборки кадра: поток без разделителя
+    /// тоже упирается в бюджет, крупное чтение уходит в долг
+    /// </summary>
+    /// <param name="size"> -- прочитано байт </param>
+    void onRecive(size_t size) override
+    {
+        if (byteRate == 0 || p_stop == nullptr)
+            return;
+        unsigned long long now = metrics_t::Now();
+        byteBudget.Refill(byteRate, byteBurst, now);
+        byteBudget.tokens -= static_cast<double>(size);
+        waitDebt(byteBudget.Debt(byteRate), now, *p_stop);
+    }
+
+    /// <summary>
+    /// метод ожидания погашения долга входящего бюджета
+    /// </summary>
+    /// <param name="wait"> -- время до погашения, мкс (0 - долга нет) </param>
+    /// <param name="now"> -- текущее время, мкс </param>
+    /// <param name="stop"> -- флаг остановки задачи от пула потоков </param>
+    void waitDebt(unsigned long long wait, unsigned long long now, const volatile std::atomic_bool& stop)
+    {
+        if (wait == 0)
+            return;
+        metric.throttled.Add();
+        metric.throttleTime.Record(wait);
+        stat->throttled.fetch_add(1, std::memory_order_relaxed);
+        // спим частями, чтобы вовремя заметить остановку
+        for (unsigned long long deadline = now + wait; !stop && !b_shutDown && !handover.b_requested && (now = metrics_t::Now()) < deadline; )
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min(deadline - now, SESSION_THROTTLE_SLICE_US)));
+    }
+
+    /// <summary>
+    /// метод приема кадра: прерывание сигналом без передачи соединения - не повод рвать связь
+    /// </summary>
+    /// <returns> результат Recive() </returns>
+    int recive()
+    {
+        int result;
+        while ((result = Recive(msg_RX.Update(), msg_RX.EOM())) == -4 && !handover.b_requested)
+            ;
+        if (result == -5) // кадр без разделителя перерос предел: дальше не читаем
+            sendNotice(TypeMsg::normal, "SYSTEM MSG: frame too long");
         return result;
     }
 
     /// <summary>
-    /// метод получения конца сообщения
+    /// метод отправки служебного сообщения своему клиенту, кадр собирается в арене сессии
     /// </summary>
-    /// <returns> конец сообщения </returns>
-    std::string EOM() const
+    /// <param name="type"> -- тип сообщения </param>
+    /// <param name="text"> -- текст сообщения (только для normal) </param>
+    /// <returns> результат Send() </returns>
+    int sendNotice(TypeMsg type, std::string_view text = std::string_view())
     {
-        return "[EOM]";
+        std::pmr::string frame(&arena);
+        frameMsg(frame, type, text);
+        return sendLocked(frame);
     }
 
     /// <summary>
-    /// метод получения текста сообщения без заголовка и конца сообщения
+    /// метод записи кадра в сокет этой сессии. Пишут в сокет сама сессия и участники ее комнаты,
+    /// мьютекс отправки не дает кадрам перемешаться. Пока идет показ истории, кадр встает в очередь сессии:
+    /// отправитель не ждет чужой показ, а переполнение очереди рвет медленного получателя
     /// </summary>
-    /// <param name="buf"> -- ссылка на буфер, куда будет положен полезный текст сообщения </param>
-    ///  <returns> 1 -- текст получен </returns>
-    bool Print(std::string& buf) const
+    /// <param name="frame"> -- кадр </param>
+    /// <param name="errCode"> -- код ошибки сокета при неудаче (опционально) </param>
+    /// <returns> результат Send(); при показе истории 0 - кадр в очереди, -2 - очередь переполнена, соединение рвется </returns>
+    int sendLocked(std::string_view frame, int* errCode = nullptr)
     {
-        buf.clear();
-        switch (Type())
-        { // расшифровка сервесных сообщений
-        case TypeMsg::shutDown:
-            buf = "SYSTEM MSG: server get command shutdown";
-            break;
-        case TypeMsg::Exit:
-            buf = "SYSTEM MSG: server get command exit from visavi client";
-            break;
-        case TypeMsg::printinfo:
-            buf = "SYSTEM MSG: other visavi not connected";
-            break;
-        case TypeMsg::linkOn:
-            buf = "SYSTEM MSG: server get connected from visavi";
-            break;
-        case TypeMsg::defaul:
-            buf = "SYSTEM MSG: server recived defined message";
-            break;
-        case TypeMsg::normal:
-            buf.assign(text, 6, text.size() - 11); // выдаем текст без заголовка и конца сообщения
-            break;
-        default:
-            break;
+        std::lock_guard<std::mutex> lock(mtx_send);
+        if (!b_replaying)
+            return sendOwned(frame, errCode);
+        if (replayQueue.size() + frame.size() <= SESSION_REPLAY_QUEUE)
+        {
+            replayQueue.append(frame.data(), frame.size());
+            return 0;
         }
-
-        return !text.empty();
+        Shutdown(); // не успевает принять ни историю, ни живые кадры - как при зависшей записи
+        return -2;
     }
 
     /// <summary>
-    /// метод задания смещения
+    /// метод записи кадра в сокет этой сессии под уже взятым mtx_send (либо из показа истории, когда остальные
+    /// пишут в очередь)
     /// </summary>
-    /// <param name="offset"> -- смещение </param>
-    void SetOffset(unsigned offset)
+    /// <param name="frame"> -- кадр </param>
+    /// <param name="errCode"> -- код ошибки сокета при неудаче (опционально) </param>
+    /// <returns> результат Send() </returns>
+    int sendOwned(std::string_view frame, int* errCode = nullptr)
     {
-        if (offset < text.size())
-            this->offset = offset;
+        stat->sendStart.store(metrics_t::Now(), std::memory_order_relaxed); // зависшую запись найдет проверка связи
+        int result = Send(frame);
+        stat->sendStart.store(0, std::memory_order_relaxed);
+        if (result != 0 && errCode != nullptr)
+            *errCode = GetSendError(); // читаем под mtx_send: следующая отправка его не перепишет
+        return result;
     }
 
     /// <summary>
-    /// метод возврата смещения
+    /// метод выписки статистики соединения из таблицы административного интерфейса (повторный вызов ничего не делает)
     /// </summary>
-    /// <returns> -- смещение </returns>
-    unsigned GetOffset() const
+    void dropStat()
     {
-        return offset;
+        std::lock_guard<std::mutex> lockStat(statTable.mutex);
+        statTable.stats.Erase(statHandle); // устаревший дескриптор slot map не совпадет
     }
 
-protected:
-    std::string text; // строка хранящее сообщение, согласно формату, опраделенному выше
-    unsigned offset; // смещение от начала сообщения
-};
+    /// <summary>
+    /// метод рассылки принятого сообщения участникам своей комнаты по снимку состава, без мьютекса комнаты:
+    /// отправители в одной комнате не ждут друг друга, запись в сокет каждого получателя - под его mtx_send
+    /// </summary>
+    /// <param name="type"> -- тип сообщения </param>
+    /// <param name="b_traced"> -- сообщение попало в выборку трассы </param>
+    void broadcast(TypeMsg type, bool b_traced)
+    {
+        rooms_t::snapshot_p members = room->Snapshot(); // держит участников живыми до конца рассылки
+        unsigned long long fanoutStart = msg_RX.Stamp(StageMsg::routed); // начало рассылки
+
+        // идем по снимку: линейный проход по непрерывному массиву
+        for (const auto& ptr : *members)
+            if (ptr.get() != this) // себе не отправляем
+            {
+                unsigned long long sendStart = metrics_t::Now(); // до этого сообщение ждет предыдущих получателей
+                int errCode = 0;
+                int result = ptr->sendLocked(msg_RX.Str(), &errCode); // отправляем сообщение собеседнику
+                traceSend(ptr->stat->id, sendStart, metrics_t::Now(), b_traced);
+
+                countSend(result, msg_RX.Str().size(), errCode);
+            }
+        metric.fanoutTime.Record(metrics_t::Now() - fanoutStart);
+        traceRoute(b_traced);
+        if (type == TypeMsg::normal)
+            history.Append(room->name, msg_RX.Str()); // только копия в очередь, диск - в потоке журнала
+
+        // если в комнате только мы и мы пытаемся написать другим
+        if (members->size() == 1 && type == TypeMsg::normal)
+            sendNotice(TypeMsg::printinfo); // диагностируем
+    }
 
-/// <summary>
-/// Класс по обработке клиентского соединения в отдельном потоке (пуле потоков).
-/// реализован на синхронных сокетах (предполагается, что ацептор также синхронен) 
-/// </summary>
-class session_t : public ABStask, public network::TCP_socketClient_t
-{
-public:
     /// <summary>
-    /// конструктор
+    /// метод отправки личного сообщения "[PRIV]<id> <текст>": одна выборка из индекса и одна запись.
+    /// Получатель видит "[PRIV]<id отправителя> <текст>"
     /// </summary>
-    /// <param name="l_visavi"> -- ссылка на список собеседников </param>
-    /// <param name="mutex"> -- ссылка на мьютекс, защищаюйщий список собеседников </param>
-    /// <param name="client"> -- ссылка на клиентский сокет, полученный ацептором </param>
-    /// <param name="aceptor"> -- информация об ацепторе </param>
-    /// <param name="b_shutDown"> -- ссылка на флаг отключения сервера </param>
-    /// <param name="logger"> -- ссылка на обект логгирования </param>
-    session_t(std::list<std::weak_ptr<session_t>>& l_visavi,
-        std::mutex& mutex, network::TCP_socketClient_t& client,
-        network::sockInfo_t acceptor,
-        volatile std::atomic_bool& b_shutDown,
-        log_t& logger) :
-        network::TCP_socketClient_t(logger), l_visavi(l_visavi), mutex(mutex), msg_RX(TypeMsg::linkOn), acceptor(acceptor), b_shutDown(b_shutDown)
+    /// <param name="b_traced"> -- сообщение попало в выборку трассы </param>
+    void sendPrivate(bool b_traced)
     {
-        Move(client); // кастомная (самодельная) move семантика
-        b_connected = GetConnected();
+        std::string_view payload = msg_RX.Payload();
+        unsigned long long to = 0;
+        auto parsed = std::from_chars(payload.data(), payload.data() + payload.size(), to);
+        if (parsed.ec != std::errc() || parsed.ptr == payload.data() + payload.size() || *parsed.ptr != ' ')
+        {
+            sendNotice(TypeMsg::normal, "SYSTEM MSG: private message format [PRIV]<id> <text>");
+            return;
+        }
+
+        std::pmr::string text(&arena); // подменяем id получателя на id отправителя
+        appendNumber(text, stat->id);
+        text.append(parsed.ptr, payload.data() + payload.size());
+        std::pmr::string frame(&arena);
+        frameMsg(frame, TypeMsg::priv, text);
+
+        int result = -2;
+        int errCode = 0;
+        std::shared_ptr<session_t> peer; // держит получателя живым после выхода из мьютекса
+        {
+            std::lock_guard<std::mutex> lock(mutex); // под мьютексом чата только выборка: запись в сокет может заблокироваться
+            msg_RX.Stamp(StageMsg::routed);
+            auto it = index.find(to);
+            session_t** ptr = it != index.end() ? registry.Get(it->second) : nullptr;
+            if (ptr != nullptr)
+                peer = (*ptr)->weak_from_this().lock(); // пустой, если сессия еще строится или уже уничтожается
+        }
+        if (peer)
+        {
+            unsigned long long sendStart = metrics_t::Now();
+            result = peer->sendLocked(frame, &errCode);
+            traceSend(to, sendStart, metrics_t::Now(), b_traced);
+            peer.reset();
+        }
+        traceRoute(b_traced);
+        metric.privateMsg.Add();
+
+        if (result == -2)
+        {
+            std::pmr::string notice("SYSTEM MSG: no client with id ", &arena);
+            appendNumber(notice, to);
+            sendNotice(TypeMsg::normal, notice);
+        }
+        else
+            countSend(result, frame.size(), errCode);
     }
 
-    // деструктор
-    ~session_t()
-    {}
+    /// <summary>
+    /// метод учета результата отправки собеседнику: метрики либо уведомление своему клиенту об ошибке
+    /// </summary>
+    /// <param name="result"> -- результат Send() </param>
+    /// <param name="size"> -- размер кадра </param>
+    /// <param name="errCode"> -- код ошибки сокета собеседника </param>
+    void countSend(int result, size_t size, int errCode)
+    {
+        if (0 != result)
+        { // диагностика ошибки
+            std::pmr::string text("SYSTEM MSG: error send message visavi, errno: ", &arena);
+            appendNumber(text, errCode);
+            sendNotice(TypeMsg::normal, text);
+        }
+        else
+        {
+            metric.msgOut.Add();
+            metric.bytesOut.Add(size);
+            stat->msgOut.fetch_add(1, std::memory_order_relaxed);
+            stat->bytesOut.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
 
     /// <summary>
-    /// потоковый метод работы, запускается в отдельном потоке в пуле потоков 
+    /// метод дописывания числа в строку арены без временных строк
     /// </summary>
-    /// <param name="stop"> -- флаг остановки задачи от пула потоков </param>
-    void Work(const volatile std::atomic_bool& stop) override
+    /// <param name="text"> -- строка </param>
+    /// <param name="value"> -- число </param>
+    template<class Number>
+    static void appendNumber(std::pmr::string& text, Number value)
     {
-        bool b_firstIter = true; // флаг первой итерации цикла
-        do // начинаем с рукопожатия
-        {   // блокируем мьютекс списка собеседников,
-            std::lock_guard<std::mutex> lock(mutex);
-            //std::cout << "IN: " << msg_RX.Str() << '\n'; ////////////////////////////////наладка
-            // обновляем флаги
-            b_connected &= GetConnected() && msg_RX.Type() != TypeMsg::Exit;
-            b_shutDown = b_shutDown || msg_RX.Type() == TypeMsg::shutDown;
+        char buf[24];
+        text.append(buf, std::to_chars(buf, buf + sizeof(buf), value).ptr);
+    }
 
-            // идем по списку собеседников
-            for (auto it = l_visavi.begin(); it != l_visavi.end(); )
-                if (auto ptr = it->lock()) // если указатель валидный
-                {
-                    if (ptr->getSocket() != this->getSocket()) // себе не отправляем
-                        if (0 != ptr->Send(msg_RX.Str())) // отправляем сообщение собеседнику
-                        { // диагностика ошибки
-                            msg_t msgTmp(TypeMsg::normal, "SYSTEM MSG: error send message visavi, errno: " + std::to_string(logger.GetLastErr()));
-                            Send(msgTmp.Str());
-                        }
-
-                    ++it;
-                }
-                else
-                    it = l_visavi.erase(it); // если указатель нулевой - удаляем
+    /// <summary>
+    /// метод входа в комнату (комната создается, если ее нет): участники получают [LINK],
+    /// мы получаем по [LINK] за каждого участника, затем последние сообщения комнаты из журнала истории
+    /// </summary>
+    /// <param name="name"> -- имя комнаты </param>
+    /// <param name="b_announce"> -- 1 - обмен [LINK] с участниками и показ истории </param>
+    void enterRoom(std::string_view name, bool b_announce = true)
+    {
+        bool b_replay = b_announce && historyReplay != 0;
+        rooms_t::snapshot_p members; // состав на момент входа, [LINK] рассылаем уже без мьютекса комнаты
+        for (;;)
+        {
+            rooms_t::room_p next = rooms.Get(name);
+            std::lock_guard<std::mutex> lock(next->mutex);
+            if (next->b_closed)
+                continue; // комнату закрыли между поиском и блокировкой - ищем (создаем) заново
 
-            // если в беседе только мы и мы пытаемся написать другим 
-            if (l_visavi.size() == 1 && msg_RX.Type() == TypeMsg::normal)
-            {   // диагностируем
-                msg_t msgTmp(TypeMsg::printinfo);
-                Send(msgTmp.Str());
+            if (b_replay)
+            { // до того, как станем видны рассылкам: их кадры встанут в очередь и придут после истории
+                std::lock_guard<std::mutex> lockSend(mtx_send); // порядок как у рассылки: мьютекс комнаты -> мьютекс отправки
+                b_replaying = true;
             }
-            else if (b_firstIter) // в первый цикл, считаем собеседников
-                for (size_t indx = l_visavi.size(); indx > 1; --indx)
+            roomHandle = next->members.Insert(shared_from_this());
+            next->Publish();
+            members = next->Snapshot();
+            room = next;
+            break;
+        }
+        if (!b_announce)
+            return;
+
+        std::pmr::string link(&arena);
+        frameMsg(link, TypeMsg::linkOn);
+        std::pmr::string links(&arena); // себе - по одному [LINK] на участника одной записью
+        for (size_t i = 1; i < members->size(); ++i)
+            links += link;
+        if (b_replay)
+        { // пока b_replaying, в сокет пишем только мы - без мьютекса отправки
+            if (!links.empty())
+                sendOwned(links);
+            replayHistory(name);
+            flushReplay();
+        }
+        else if (!links.empty())
+            sendLocked(links);
+        for (const auto& ptr : *members)
+            if (ptr.get() != this)
+                ptr->sendLocked(link);
+    }
+
+    /// <summary>
+    /// метод показа истории комнаты: последние historyReplay сообщений идут в сокет из файлов журнала как есть
+    /// (кадры хранятся в том виде, что уходят собеседникам), без копирования через пользовательские буферы.
+    /// Вызывать при взведенном b_replaying: рассылки в комнату тем временем копятся в очереди сессии.
+    /// Сообщение, разосланное в момент входа, может прийти и в истории, и вживую
+    /// </summary>
+    /// <param name="name"> -- имя комнаты </param>
+    void replayHistory(std::string_view name)
+    {
+        unsigned long long start = metrics_t::Now();
+        stat->sendStart.store(start, std::memory_order_relaxed); // зависший показ найдет проверка связи
+        history.Flush(false); // в журнал попадает все, что разослано до нашего входа
+        std::vector<history_t::slice_t> v_slice;
+        size_t count = history.Last(name, historyReplay, v_slice);
+        for (const history_t::slice_t& slice : v_slice)
+            if (0 != SendFile(slice.path, slice.offset, slice.size))
+                break;
+        stat->sendStart.store(0, std::memory_order_relaxed);
+        metric.replayed.Add(count);
+        metric.replayTime.Record(metrics_t::Now() - start);
+    }
+
+    /// <summary>
+    /// метод выгрузки живых кадров, накопленных за показ истории, и возврата к записи под мьютексом отправки
+    /// </summary>
+    void flushReplay()
+    {
+        for (;;)
+        {
+            std::string pending;
+            {
+                std::lock_guard<std::mutex> lock(mtx_send);
+                if (replayQueue.empty())
                 {
-                    msg_t msgTmp(TypeMsg::linkOn);
-                    Send(msgTmp.Str());
+                    b_replaying = false;
+                    std::string().swap(replayQueue); // очередь нужна только на время входа
+                    return;
                 }
-            b_firstIter = false;
-
-            // если сервер отключается из-за нас
-            if (b_shutDown && msg_RX.Type() == TypeMsg::shutDown)
+                pending.swap(replayQueue);
+            }
+            if (0 != sendOwned(pending))
             {
-                msg_t msgTmp(TypeMsg::normal, "SYSTEM MSG: server shutdown"); // подтверждаем клиенту свое отключение
-                Send(msgTmp.Str());
-                network::TCP_socketClient_t signal(acceptor, logger); // толкаем ацептор в главном потоке
-                break; // выходим
+                std::lock_guard<std::mutex> lock(mtx_send);
+                b_replaying = false;
+                std::string().swap(replayQueue);
+                return;
             }
-            // крутимся пока нет остановки и есть связь, и мы приняли сообщение, и нет отключения сервера
-        } while (!stop && b_connected && 0 == Recive(msg_RX.Update(), msg_RX.EOM()) && !b_shutDown);
+        }
+    }
 
-        // логгируем активность
-        std::lock_guard<std::mutex> lock(mutex);
-        // удаляем нулевые указатели
-        for (auto it = l_visavi.begin(); it != l_visavi.end(); )
-            if (auto ptr = it->lock())
-                ++it;
-            else
-                it = l_visavi.erase(it);
-        // вывод в лог
-        logger.doLog("Close client, count client: " + std::to_string(l_visavi.size() - 1));
+    /// <summary>
+    /// метод выхода из текущей комнаты, пустая комната убирается из индекса
+    /// </summary>
+    /// <param name="b_announce"> -- 1 - оставшиеся участники получают [EXIT] </param>
+    void leaveRoom(bool b_announce)
+    {
+        if (!room)
+            return;
+        rooms_t::snapshot_p members; // состав после выхода, [EXIT] рассылаем уже без мьютекса комнаты
+        {
+            std::lock_guard<std::mutex> lock(room->mutex);
+            room->members.Erase(roomHandle);
+            room->Publish(); // рассылки по старому снимку еще могут дойти до нас - это допустимо
+            members = room->Snapshot();
+        }
+        if (b_announce)
+        {
+            std::pmr::string exit(&arena);
+            frameMsg(exit, TypeMsg::Exit);
+            for (const auto& ptr : *members)
+                ptr->sendLocked(exit);
+        }
+        rooms.Release(room);
+        room.reset();
     }
-protected:
-    std::list<std::weak_ptr<session_t>>& l_visavi; // ссылка на список собеседников
-    std::mutex& mutex; // ссылка на мьютекс, защищающий список собеседников
+
+    /// <summary>
+    /// метод учета этапов до рассылки: разбор заголовка и получение маршрута (снимок комнаты либо индекс)
+    /// </summary>
+    /// <param name="b_traced"> -- сообщение попало в выборку трассы </param>
+    void traceRoute(bool b_traced)
+    {
+        unsigned long long recv = msg_RX.GetStamp(StageMsg::recived);
+        unsigned long long parse = msg_RX.GetStamp(StageMsg::parsed);
+        unsigned long long route = msg_RX.GetStamp(StageMsg::routed);
+        metric.parseTime.Record(parse - recv);
+        metric.lockWait.Record(route - parse);
+        if (b_traced)
+        {
+            trace.Event("parse", stat->id, recv, parse);
+            trace.Event("lock_wait", stat->id, parse, route);
+        }
+    }
+
+    /// <summary>
+    /// метод учета доставки сообщения одному собеседнику
+    /// </summary>
+    /// <param name="to"> -- номер соединения получателя </param>
+    /// <param name="sendStart"> -- начало записи в сокет получателя, мкс </param>
+    /// <param name="sendEnd"> -- конец записи в сокет получателя, мкс </param>
+    /// <param name="b_traced"> -- сообщение попало в выборку трассы </param>
+    void traceSend(unsigned long long to, unsigned long long sendStart, unsigned long long sendEnd, bool b_traced)
+    {
+        unsigned long long route = msg_RX.GetStamp(StageMsg::routed);
+        metric.fanoutWait.Record(sendStart - route);
+        metric.sendTime.Record(sendEnd - sendStart);
+        metric.deliverTime.Record(sendEnd - msg_RX.GetStamp(StageMsg::recived));
+        if (b_traced)
+        {
+            trace.Event("fanout_wait", stat->id, route, sendStart, to);
+            trace.Event("send", stat->id, sendStart, sendEnd, to);
+        }
+    }
+
+    registry_t& registry; // ссылка на реестр собеседников
+    sessionIndex_t& index; // ссылка на индекс номер соединения -> дескриптор в реестре
+    slotHandle_t handle; // дескриптор сессии в реестре
+    std::mutex& mutex; // ссылка на мьютекс, защищающий реестр собеседников
+    rooms_t& rooms; // ссылка на индекс комнат
+    rooms_t::room_p room; // текущая комната (пусто до рукопожатия и после выхода)
+    slotHandle_t roomHandle; // дескриптор сессии среди участников комнаты
+    std::mutex mtx_send; // мьютекс записи в сокет этой сессии
+    bool b_replaying; // идет показ истории: рассылки пишут в replayQueue (под mtx_send)
+    std::string replayQueue; // живые кадры, пришедшие за время показа истории (под mtx_send)
+
     msg_t msg_RX; // буфер для принятого от клиента сообщения
-    network::sockInfo_t acceptor; // информация об ацепторе
+    network::wakeup_t& wakeup; // событие остановки приема
     volatile std::atomic_bool& b_shutDown; // ссылка на флаг отключения сервера
+    bool b_drained; // клиент уведомлен об остановке сервера, запись закрыта (под мьютексом чата)
+    handover_t& handover; // ссылка на состояние передачи соединений новому процессу
+    std::atomic_bool b_quiet; // при передаче: сессия больше не читает и не рассылает
+    const bool b_resumed; // соединение принято от прошлого процесса
+    std::string resumeRoom; // комната соединения в прошлом процессе
+#ifndef __WIN32__
+    pthread_t thread; // поток пула, в котором работает сессия (для Interrupt())
+#endif
     bool b_connected; // флаг наличия соединения с клиентом
+    std::shared_ptr<sessionStat_t> stat; // статистика соединения для административного интерфейса
+    statTable_t& statTable; // таблица статистики соединений
+    slotHandle_t statHandle; // дескриптор статистики в таблице
+    trace_t& trace; // ссылка на трассу сообщений
+    history_t& history; // ссылка на журнал истории комнат
+    sessionMetrics_t& metric; // метрики сессий, общие для всех соединений
+    memPool_t& sessionPool; // ссылка на пул сессий
+    size_t arenaSize; // размер начального блока арены
+    void* arenaBuf; // начальный блок арены из пула сессий, переполнение уходит в кучу
+    std::pmr::monotonic_buffer_resource arena; // арена временных строк одного сообщения, сбрасывается после его обработки
+    admission_t& admission; // допуск подключений
+    const unsigned msgRate; // входящих сообщений в секунду (0 - без ограничения)
+    const unsigned msgBurst; // запас входящих сообщений
+    const unsigned byteRate; // входящих байт в секунду (0 - без ограничения)
+    const unsigned byteBurst; // запас входящих байт
+    tokenBucket_t msgBudget; // входящий бюджет сообщений
+    tokenBucket_t byteBudget; // входящий бюджет байт
+    const volatile std::atomic_bool* p_stop; // флаг остановки задачи от пула потоков (для onRecive())
+    const size_t historyReplay; // последних сообщений комнаты, показываемых при входе (0 - не показывать)
 };
 
+
 /// <summary>
 /// класс управляющий чатом
 /// </summary>
@@ -288,121 +843,570 @@ class chat_manager_t
 {
 public:
     /// <summary>
-    /// конструктор
+    /// конструктор: все, что нужно соединениям, резервируется здесь под config.maxClients
     /// </summary>
-    /// <param name="port"> -- номер порта для прослушивания </param>
-    chat_manager_t(unsigned port) : logger("server.log", true), acceptor(IP_ADRES, port, logger), pool(MAX_COUNT_CLIENT)
+    /// <param name="config"> -- параметры сервера </param>
+    chat_manager_t(const config_t& config) : logger("server.log", true), config(config),
+        admission(config.admissionTable, config.connRate, config.connBurst, config.connRateIP, config.connBurstIP, config.connMaxIP),
+        inherited(receiveHandoff()),
+        acceptor(config.listen, static_cast<unsigned short>(config.port), logger, config.backlog, network::sockProfile_t::Find(config.socketProfile),
+            inherited.listen),
+        sessionMetrics(metrics), trace(logger), history(logger, metrics), wakeup(logger), b_shutDown(false), pool(config.poolThreads, &metrics),
+        accepts(metrics.Counter("chat.accepts")), rejects(metrics.Counter("chat.rejects_max_clients")), clients(metrics.Gauge("chat.clients")),
+        acceptBatch(metrics.Histogram("chat.accept_batch")), v_accepted(config.acceptBatch),
+        pings(metrics.Counter("session.pings")), evictedIdle(metrics.Counter("session.evicted_idle")),
+        evictedStall(metrics.Counter("session.evicted_write_stall")), heartbeatTimers(metrics.Gauge("heartbeat.timers")),
+        pingInterval(config.pingIntervalMs * 1000ull),
+        idleTimeout(config.idleTimeoutMs * 1000ull), writeStall(config.writeStallMs * 1000ull),
+        timers(HEARTBEAT_SLOTS, HEARTBEAT_TICK_MS * 1000ull, metrics_t::Now()),
+        sessionID(inherited.sessionID), interruptSignal(0)
     {
+        static const char* rejectNames[countAdmit] = { nullptr, "admission.rejects_rate", "admission.rejects_rate_ip",
+            "admission.rejects_conn_ip", "admission.rejects_table_full" };
+        admissionRejects[admitted] = nullptr;
+        for (int i = rejectRate; i < countAdmit; ++i)
+            admissionRejects[i] = &metrics.Counter(rejectNames[i]);
+
+        network::TCP_socketClient_t::SetRecvChunk(config.recvChunk);
+        network::TCP_socketClient_t::SetMaxFrame(config.maxFrame);
+        registry.Reserve(config.maxClients);
+        index.reserve(config.maxClients);
+        // сессии, их статистика и арены - из пула сессий, буферы приема - из общего пула
+        sessionPool.Reserve(sizeof(session_t) + SESSION_PREALLOC_SLACK, config.maxClients);
+        sessionPool.Reserve(sizeof(sessionStat_t) + SESSION_PREALLOC_SLACK, config.maxClients);
+        sessionPool.Reserve(config.sessionArena, config.maxClients);
+        memPool_t::Global().Reserve(config.recvChunk + 1, config.maxClients);
+
+        trace.Open(TRACE_FILE, config.traceSample);
+        history_t::policy_t historyPolicy = history_t::interval;
+        history_t::FindPolicy(config.historyFsync, historyPolicy);
+        history.Open(config.historyDir, historyPolicy, config.historyFsyncMs, config.historyFsyncEvery, config.historySegmentMb * (1ull << 20));
+        if (!inherited.v_session.empty())
+        { // соединения прошлого процесса продолжают работу со своими номерами и комнатами
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const handoffSession_t& resumed : inherited.v_session)
+                resume(resumed);
+            inherited.v_session.clear();
+        }
+        if (!config.handoffPath.empty())
+        { // ждем преемника для следующего перезапуска
+            handoff.reset(new handoff_t(config.handoffPath, logger));
+            interruptSignal = handoff_t::InstallInterrupt();
+            if (handoff->Listen())
+                handoffThread = std::thread([this]() { HandoffWork(); });
+        }
+        if (config.adminPort != 0)
+        { // административный интерфейс слушает свой адрес (по умолчанию локальный)
+            adminAcceptor.reset(new network::TCP_socketServer_t(config.adminListen, static_cast<unsigned short>(config.adminPort), logger));
+            adminThread = std::thread([this]() { AdminWork(); });
+        }
+        heartbeatThread = std::thread([this]() { HeartbeatWork(); }); // без проверки связи колесо пустое, поток только сбрасывает сводки лога
         logger.doLog("server run");
     }
 
     ~chat_manager_t()
     { 
-        std::chrono::seconds sec{ 1 }; // ждем секунду на завершение потоков
-        std::this_thread::sleep_for(sec);
-        // собеседники должны успеть толкнуть свои соединения, для завершения задач(соединений)
-        std::lock_guard<std::mutex> lock(mutex); // проверяем это
-        // идем по списку задач(собеседников) и чистим выполненные
-        for (auto it = l_task.begin(); it != l_task.end(); )
-        {
-            if (auto ptr = it->lock()) // выключаем живые соединения, если еще кто жив
-                ptr->Shutdown();
-            it = l_task.erase(it);
-        }
+        if (handover.b_requested)
+            handOver(); // отданные преемнику сессии уже не в реестре, остальных остановим как обычно
+        Stop(); // Work() мог выйти и по ошибке ацептора
+        if (heartbeatThread.joinable())
+            heartbeatThread.join(); // поток выходит за шаг колеса
+        if (adminThread.joinable())
+            adminThread.join(); // ацептор административного интерфейса разбужен событием
+        if (handoffThread.joinable())
+            handoffThread.join();
+        drain();
+        std::lock_guard<std::mutex> lock(mutex);
+        // срок вышел: выключаем живые соединения, если еще кто жив, и закрываем реестр:
+        // сессии, которые пул так и не запустил, в реестре больше не видны
+        for (session_t* ptr : registry)
+            ptr->Shutdown();
+        registry.Clear();
+        index.clear();
+
         logger.doLog("server shutdown");
     }
+    /// <summary>
+    /// метод запроса остановки: прием прекращается, Work() возвращает управление, остальное делает деструктор.
+    /// Годится для обработчика сигнала (атомарная запись и один write())
+    /// </summary>
+    void Stop()
+    {
+        b_shutDown = true;
+        wakeup.Signal();
+    }
+
     /// <summary>
     /// основной метод работы
     /// </summary>
     void Work()
     {
-        while (!b_shutDown)
+        while (!b_shutDown && !handover.b_requested)
         {
-            network::TCP_socketClient_t tmpClient(logger); // буфер для получения клиентов от ацептора
-            if (0 == acceptor.AddClient(tmpClient)) // получаем подключение
-            { // если получили валидное подключение
-                std::lock_guard<std::mutex> lock(mutex);
-                if (!b_shutDown) // и нет команды на отключение
+            // одно ожидание готовности - и вся очередь подключений (до размера массива) за несколько accept4
+            int count = acceptor.AcceptBatch(v_accepted.data(), v_accepted.size(), -1, false, &wakeup);
+            if (count < 0)
+            {
+                b_shutDown = true;
+                break;
+            }
+            if (count == 0)
+            { // остановка, кончились дескрипторы либо прерванное ожидание: даем сессиям освободить дескрипторы
+                if (b_shutDown || handover.b_requested)
+                    break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(ACCEPT_RETRY_MS));
+                continue;
+            }
+            acceptBatch.Record(count);
+
+            // допуск - сразу после accept, до сессии и мьютекса чата: отказ стоит одного close()
+            unsigned long long now = metrics_t::Now();
+            int admittedCount = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                AdmitResult result = admission.Admit(v_accepted[i].peer, now);
+                if (result == admitted)
+                    v_accepted[admittedCount++] = v_accepted[i];
+                else
                 {
-                    // идем по списку задач(собеседников) и чистим выполненные
-                    for (auto it = l_task.begin(); it != l_task.end(); )
-                        if (auto ptr = it->lock())
-                            ++it;
-                        else
-                            it = l_task.erase(it);
-
-                    if (l_task.size() < MAX_COUNT_CLIENT) // если размер позволяет
-                    {   // добавляем задачу (собеседника)
-                        auto newTask = std::make_shared<session_t>(l_task, mutex, tmpClient, acceptor.GetSockInfo(), b_shutDown, logger);
-                        pool.AddTask(newTask);
-                        l_task.push_back(newTask);
-                        logger.doLog("Connected new client, count client: " + std::to_string(l_task.size()));
+                    CLOSE_SOCKET(v_accepted[i].socket);
+                    admissionRejects[result]->Add();
+                    DO_LOG_LIMITED(logger, "Connection rejected by admission control");
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex); // мьютекс чата - один раз на пачку
+            for (int i = 0; i < admittedCount; ++i)
+            {
+                network::TCP_socketClient_t tmpClient(logger); // буфер для получения клиентов от ацептора
+                if (0 == acceptor.AddClient(tmpClient, v_accepted[i]) && !b_shutDown) // при отключении сокет закроется с tmpClient
+                    admit(tmpClient);
+                else
+                    admission.Release(v_accepted[i].peer);
+            }
+        }
+    }
+protected:
+    /// <summary>
+    /// метод регистрации принятого подключения (вызывать под мьютексом чата)
+    /// </summary>
+    /// <param name="client"> -- подключенный клиент </param>
+    /// <param name="resumed"> -- сессия, принятая от прошлого процесса (nullptr - новое подключение) </param>
+    void admit(network::TCP_socketClient_t& client, const handoffSession_t* resumed = nullptr)
+    {
+        if (registry.Size() < config.maxClients) // если размер позволяет (сессии выписываются из реестра сами)
+        {   // регистрируем статистику соединения для административного интерфейса
+            auto stat = std::allocate_shared<sessionStat_t>(poolAllocator_t<sessionStat_t>(sessionPool), resumed ? resumed->id : ++sessionID,
+                client.GetRemoteInfo());
+            // добавляем задачу (собеседника), сессия сама встает в реестр и в таблицу статистики
+            auto newTask = std::allocate_shared<session_t>(poolAllocator_t<session_t>(sessionPool), registry, index, mutex, rooms, sessionPool, config, admission, client, wakeup, b_shutDown, handover, resumed, sessionMetrics, stat, statTable, trace, history, logger);
+            pool.AddTask(newTask);
+            if (pingInterval != 0 || idleTimeout != 0 || writeStall != 0)
+            {
+                std::lock_guard<std::mutex> lockTimer(mtx_timer);
+                timers.Schedule(stat->id, nextCheck(*stat, metrics_t::Now()));
+            }
+            accepts.Add();
+            clients.Set(registry.Size());
+            DO_LOG_LIMITED(logger, "Connected new client, count client: " + std::to_string(registry.Size()));
+        }
+        else
+        { // иначе, диагностируем превышение размера
+            msg_t msg(TypeMsg::normal, "SYSTEM MSG: Maximum number of clients reached");
+            client.Send(msg.Str());
+            admission.Release(client.GetRemoteInfo());
+            rejects.Add();
+            DO_LOG_LIMITED(logger, "Maximum number of clients reached");
+        }
+    }
+
+    /// <summary>
+    /// метод приема состояния у прошлого процесса при запуске с takeover (вызывается до создания ацептора)
+    /// </summary>
+    /// <returns> состояние; пустое - прошлого процесса нет, стартуем с чистого листа </returns>
+    handoffState_t receiveHandoff()
+    {
+        handoffState_t state;
+        if (config.takeover)
+        {
+            if (handoff_t(config.handoffPath, logger).Receive(state))
+                logger.doLog("takeover: sessions " + std::to_string(state.v_session.size()));
+            else
+                logger.doLog("takeover failed, starting without previous process");
+        }
+        return state;
+    }
+
+    /// <summary>
+    /// метод продолжения соединения, принятого от прошлого процесса (вызывать под мьютексом чата)
+    /// </summary>
+    /// <param name="resumed"> -- сессия прошлого процесса </param>
+    void resume(const handoffSession_t& resumed)
+    {
+        network::accepted_t accepted{ resumed.socket, network::endpoint_t() };
+        socklen_t sizeAddr = accepted.peer.Size();
+        if (getpeername(resumed.socket, accepted.peer.Data(), &sizeAddr))
+            accepted.peer.Clear(); // клиент уже ушел - сессия узнает это при первом приеме
+
+        network::TCP_socketClient_t tmpClient(logger);
+        if (0 != acceptor.AddClient(tmpClient, accepted))
+            return;
+        admission.Track(accepted.peer, metrics_t::Now()); // лимиты этот клиент прошел в прошлом процессе
+        admit(tmpClient, &resumed);
+    }
+
+    /// <summary>
+    /// метод работы потока ожидания преемника: его подключение останавливает прием, остальное делает деструктор
+    /// </summary>
+    void HandoffWork()
+    {
+        if (handoff->Wait(wakeup))
+        {
+            logger.doLog("handoff: successor connected");
+            handover.b_requested = true;
+            wakeup.Signal();
+        }
+    }
+
+    /// <summary>
+    /// метод передачи соединений преемнику. Сессии дорабатывают текущий кадр и затихают (ждущих в recv будит сигнал);
+    /// когда затихли все - рассылок больше нет, и каждая отдает сокет и непрочитанный хвост приема.
+    /// Не затихшие к config.drainTimeoutMs остаются нам и останавливаются как обычно
+    /// </summary>
+    void handOver()
+    {
+        unsigned long long deadline = metrics_t::Now() + config.drainTimeoutMs * 1000ull;
+        for (;;)
+        {
+            size_t busy = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (session_t* ptr : registry)
+                    if (!ptr->Quiet())
+                    {
+                        ptr->Interrupt(interruptSignal);
+                        ++busy;
                     }
-                    else
-                    { // иначе, диагностируем превышение размера
-                        msg_t msg(TypeMsg::normal, "SYSTEM MSG: Maximum number of clients reached");
-                        tmpClient.Send(msg.Str());
-                        logger.doLog("Maximum number of clients reached");
+            }
+            if (busy == 0 || metrics_t::Now() >= deadline)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_POLL_MS));
+        }
+
+        handover.b_release = true;
+        for (size_t quiet = 1; quiet != 0; )
+        { // затихшие выписываются из реестра, сдав сокет
+            std::this_thread::sleep_for(std::chrono::milliseconds(SESSION_HANDOVER_POLL_MS));
+            std::lock_guard<std::mutex> lock(mutex);
+            quiet = 0;
+            for (session_t* ptr : registry)
+                quiet += ptr->Quiet();
+        }
+
+        if (adminThread.joinable())
+            adminThread.join(); // поток вышел по флагу передачи
+        if (adminAcceptor)
+            adminAcceptor->StopListen(); // порт административного интерфейса нужен преемнику
+
+        history.Flush(); // преемник продолжит журналы комнат с того, что уже на диске
+
+        handoffState_t state;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            state.v_session.swap(handover.state.v_session);
+            state.sessionID = sessionID;
+        }
+        state.listen = acceptor.ListenSocket();
+        bool b_sent = handoff->Send(state);
+        for (const handoffSession_t& parked : state.v_session)
+            CLOSE_SOCKET(parked.socket); // у преемника свои копии; без него клиенты получат разрыв и переподключатся
+        logger.doLog(std::string(b_sent ? "handoff: sent sessions " : "handoff failed, dropped sessions ")
+            + std::to_string(state.v_session.size()));
+    }
+
+    /// <summary>
+    /// метод плавной остановки (прием уже остановлен): слушающий сокет закрывается, каждый собеседник получает
+    /// уведомление следом за уже начатыми кадрами, его запись закрывается, и клиенты отключаются сами.
+    /// Ждем этого не дольше config.drainTimeoutMs, оставшихся отключает деструктор
+    /// </summary>
+    void drain()
+    {
+        static const std::string notice = msg_t(TypeMsg::normal, "SYSTEM MSG: server is shutting down").Str();
+        acceptor.StopListen();
+        unsigned long long deadline = metrics_t::Now() + config.drainTimeoutMs * 1000ull;
+        size_t left = 0;
+        do
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (session_t* ptr : registry)
+                    ptr->Drain(notice); // занятый сокет - на следующем шаге
+                left = registry.Size();
+            }
+            if (left == 0)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_POLL_MS));
+        } while (metrics_t::Now() < deadline);
+
+        if (left != 0)
+            logger.doLog("drain deadline: clients left " + std::to_string(left));
+    }
+
+    /// <summary>
+    /// метод расчета следующей проверки соединения: ближайший из сроков тишины, проверки связи и зависания записи
+    /// </summary>
+    /// <param name="stat"> -- статистика соединения </param>
+    /// <param name="now"> -- текущее время, мкс </param>
+    /// <returns> время следующей проверки, мкс </returns>
+    unsigned long long nextCheck(const sessionStat_t& stat, unsigned long long now) const
+    {
+        unsigned long long last = stat.lastRecv.load(std::memory_order_relaxed);
+        unsigned long long sendStart = stat.sendStart.load(std::memory_order_relaxed);
+        unsigned long long next = ~0ull;
+        if (idleTimeout != 0)
+            next = std::min(next, last + idleTimeout);
+        if (pingInterval != 0 && !stat.pinged.load(std::memory_order_relaxed))
+            next = std::min(next, last + pingInterval);
+        if (writeStall != 0) // запись может начаться в любой момент - смотрим не реже раза за writeStall
+            next = std::min(next, (sendStart != 0 ? sendStart : now) + writeStall);
+        return std::max(next, now + HEARTBEAT_TICK_MS * 1000ull);
+    }
+
+    /// <summary>
+    /// метод проверки одного соединения по его таймеру (вызывать под мьютексом чата)
+    /// </summary>
+    /// <param name="session"> -- сессия </param>
+    /// <param name="now"> -- текущее время, мкс </param>
+    /// <returns> 1 - соединение живо, поставить таймер заново; 0 - соединение отключено </returns>
+    bool heartbeat(session_t& session, unsigned long long now)
+    {
+        sessionStat_t& stat = session.Stat();
+        auto elapsed = [now](unsigned long long since) { return now > since ? now - since : 0ull; };
+        const char* reason = nullptr;
+
+        unsigned long long sendStart = stat.sendStart.load(std::memory_order_relaxed);
+        unsigned long long silence = elapsed(stat.lastRecv.load(std::memory_order_relaxed));
+        if (writeStall != 0 && sendStart != 0 && elapsed(sendStart) >= writeStall)
+            reason = "write stall";
+        else if (idleTimeout != 0 && silence >= idleTimeout)
+            reason = "idle timeout";
+        else if (pingInterval != 0 && silence >= pingInterval && !stat.pinged.load(std::memory_order_relaxed))
+        {
+            int result = session.Ping();
+            if (result == 0)
+            {
+                stat.pinged.store(true, std::memory_order_relaxed);
+                pings.Add();
+            }
+            else if (result > 0 || result == -1) // кадр ушел не целиком либо сокет сломан - поток кадров уже не восстановить
+                reason = "write stall";
+            // -2: сессия сама заметит разрыв; -3, -4: сокет занят, повторим на следующей проверке
+        }
+        if (reason == nullptr)
+            return true;
+
+        (reason[0] == 'i' ? evictedIdle : evictedStall).Add();
+        session.Shutdown(); // поток сессии выйдет из Recive() и выпишется из реестра сам
+        DO_LOG_LIMITED(logger, std::string("Client evicted: ") + reason);
+        return false;
+    }
+
+    /// <summary>
+    /// метод работы потока проверки связи: раз в шаг колеса снимаем наступившие сроки и проверяем эти соединения,
+    /// заодно пишем сводки лога по замолчавшим местам вызова. Мьютекс колеса и мьютекс чата не берутся вместе
+    /// </summary>
+    void HeartbeatWork()
+    {
+        std::vector<unsigned long long> v_due; // номера соединений с наступившим сроком (буфер переиспользуется)
+        std::vector<unsigned long long> v_next; // новые сроки живых соединений
+        while (!b_shutDown && !handover.b_requested)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(HEARTBEAT_TICK_MS));
+            logger.FlushLimited();
+            unsigned long long now = metrics_t::Now();
+            {
+                std::lock_guard<std::mutex> lockTimer(mtx_timer);
+                timers.Advance(now, [&v_due](unsigned long long id) { v_due.push_back(id); });
+            }
+            if (v_due.empty())
+                continue;
+
+            size_t due = 0; // живые соединения сдвигаются в начало v_due вместе со сроками в v_next
+            v_next.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (unsigned long long id : v_due)
+                {
+                    auto it = index.find(id);
+                    session_t** ptr = it != index.end() ? registry.Get(it->second) : nullptr;
+                    if (ptr != nullptr && heartbeat(**ptr, now)) // закрытое соединение таймер не возвращает
+                    {
+                        v_due[due++] = id;
+                        v_next.push_back(nextCheck((*ptr)->Stat(), now));
                     }
                 }
             }
-            else
-                b_shutDown = true;
+            {
+                std::lock_guard<std::mutex> lockTimer(mtx_timer);
+                for (size_t i = 0; i < due; ++i)
+                    timers.Schedule(v_due[i], v_next[i]);
+                heartbeatTimers.Set(timers.Size());
+            }
+            v_due.clear();
         }
     }
-protected:
+
+    /// <summary>
+    /// метод работы административного интерфейса: каждому подключившемуся отдаем текстовый снимок состояния сервера
+    /// </summary>
+    void AdminWork()
+    {
+        while (!b_shutDown && !handover.b_requested)
+        {
+            network::accepted_t accepted;
+            int count = adminAcceptor->AcceptBatch(&accepted, 1, -1, false, &wakeup);
+            if (count < 0)
+                break; // ошибка уже залоггирована ацептором
+            network::TCP_socketClient_t tmpClient(logger); // буфер для получения клиентов от ацептора
+            if (count == 0 || 0 != adminAcceptor->AddClient(tmpClient, accepted) || b_shutDown)
+                continue; // при остановке сокет закроется с tmpClient
+
+            std::string report;
+            Report(report);
+            tmpClient.Send(report);
+        }
+    }
+
+    /// <summary>
+    /// метод формирования снимка состояния сервера: метрики, состояние пула, соединения.
+    /// Мьютекс чата не используется
+    /// </summary>
+    /// <param name="buf"> -- буфер для вывода </param>
+    void Report(std::string& buf)
+    {
+        buf = "# config\n";
+        config.Print(buf);
+        buf += "# metrics\n";
+        metrics.Print(buf);
+        buf += "# admission\n";
+        admission.Print(buf);
+
+        size_t threads = 0, active = 0, queued = 0;
+        pool.GetStatus(threads, active, queued);
+        buf += "# pool\npool.threads " + std::to_string(threads) + "\npool.active " + std::to_string(active)
+            + "\npool.queued " + std::to_string(queued) + "\n# mempool\n";
+        sessionPool.Print(buf, "mempool.session");
+        memPool_t::Global().Print(buf, "mempool.buffer");
+        buf += "# rooms\n";
+        rooms.Print(buf);
+
+        buf += "# sessions\n";
+
+        unsigned long long now = metrics_t::Now();
+        std::lock_guard<std::mutex> lock(statTable.mutex);
+        for (const auto& stat : statTable.stats)
+        {
+            char peer[ENDPOINT_STRLEN];
+            buf += "id=" + std::to_string(stat->id) + " peer=";
+            buf.append(peer, stat->peer.Format(peer, sizeof(peer)));
+            buf += std::string(" state=") + (stat->active ? "active" : "queued")
+                + " uptime_s=" + std::to_string((now - stat->start) / 1000000)
+                + " msg_in=" + std::to_string(stat->msgIn.load(std::memory_order_relaxed))
+                + " msg_out=" + std::to_string(stat->msgOut.load(std::memory_order_relaxed))
+                + " bytes_in=" + std::to_string(stat->bytesIn.load(std::memory_order_relaxed))
+                + " bytes_out=" + std::to_string(stat->bytesOut.load(std::memory_order_relaxed))
+                + " throttled=" + std::to_string(stat->throttled.load(std::memory_order_relaxed)) + '\n';
+        }
+    }
+
     log_t logger; // объект для логгирования
+    const config_t config; // параметры сервера
+    memPool_t sessionPool; // пул сессий и их статистики (объявлен раньше пула потоков и списков, разрушается после них)
+    admission_t admission; // допуск подключений (сессии снимают с учета свои подключения при разрушении)
+    handoffState_t inherited; // состояние, принятое от прошлого процесса (слушающий сокет и соединения)
+
     network::TCP_socketServer_t acceptor; // ацептор
-    poolThread_manager_t pool; // пул потоков
+    metrics_t metrics; // реестр метрик
+    sessionMetrics_t sessionMetrics; // метрики сессий, разрешаются один раз для всех соединений
+    trace_t trace; // выборочная трасса сообщений
+    history_t history; // журнал истории комнат (писатель останавливается после пула потоков)
+    network::wakeup_t wakeup; // событие остановки: будит ацепторы чата и административного интерфейса
+    // все, на что ссылаются сессии, объявлено раньше пула потоков: пул разрушается первым и дожидается сессий
     volatile std::atomic_bool b_shutDown; // флаг отключения сервера
-    std::list<std::weak_ptr<session_t>> l_task; // список собеседников
-    std::mutex mutex; // мьютекс защиты списка собеседников
-};
-
+    handover_t handover; // передача соединений преемнику
+    registry_t registry; // реестр собеседников
+    sessionIndex_t index; // номер соединения -> дескриптор в реестре (для личных сообщений)
+    std::mutex mutex; // мьютекс защиты реестра собеседников
+    rooms_t rooms; // индекс комнат
+    poolThread_manager_t pool; // пул потоков
+    counter_t& accepts; // метрика: принято подключений
+    counter_t& rejects; // метрика: отклонено подключений по config.maxClients
+    gauge_t& clients; // метрика: текущее количество собеседников
+    histogram_t& acceptBatch; // метрика: подключений, принятых за одно пробуждение ацептора
+    std::vector<network::accepted_t> v_accepted; // пачка принятых подключений, выделена один раз под config.acceptBatch
+    counter_t* admissionRejects[countAdmit]; // метрики: отказы допуска по причинам (admitted не используется)
+    counter_t& pings; // метрика: отправлено проверок связи [PING]
+    counter_t& evictedIdle; // метрика: отключено молчащих собеседников
+    counter_t& evictedStall; // метрика: отключено собеседников с зависшей записью
+    gauge_t& heartbeatTimers; // метрика: таймеров на колесе проверки связи
+    const unsigned long long pingInterval; // тишина до проверки связи, мкс (0 - не проверять)
+    const unsigned long long idleTimeout; // тишина до отключения, мкс (0 - не отключать)
+    const unsigned long long writeStall; // зависание записи до отключения, мкс (0 - не отключать)
+    std::mutex mtx_timer; // мьютекс колеса таймеров (поток проверки связи не держит его вместе с мьютексом чата)
+    timerWheel_t<unsigned long long> timers; // сроки проверки связи по номерам соединений
 
+    unsigned long long sessionID; // автоинкремент номера соединения
+    statTable_t statTable; // статистика соединений для административного интерфейса
+    std::unique_ptr<network::TCP_socketServer_t> adminAcceptor; // ацептор административного интерфейса
+    std::thread adminThread; // поток административного интерфейса
+    std::thread heartbeatThread; // поток проверки связи
+    std::unique_ptr<handoff_t> handoff; // точка ожидания преемника (пусто - перезапуск без передачи)
+    int interruptSignal; // сигнал прерывания recv в потоках сессий
+    std::thread handoffThread; // поток ожидания преемника
+};
 
-/// <summary>
-/// функция разобра параметров командной строки
-/// </summary>
-/// <param name="argc"> - количество параметров </param>
-/// <param name="argv"> - массив параметров </param>
-/// <param name="r_port"> - ссылка на порт для прослушки </param>
-/// <returns> 1 - праметры распознаны </returns>
-bool parseParam(int argc, char* argv[], unsigned& r_port);
 
 
-int main(int argc, char* argv[])
+namespace
 {
-    unsigned u32_port = 0;
+    std::atomic<chat_manager_t*> g_chat(nullptr); // работающий чат для обработчика сигналов остановки
 
-    if (parseParam(argc, argv, u32_port))
+    /// <summary>
+    /// обработчик SIGINT/SIGTERM: первый сигнал - плавная остановка, повторный - обычное завершение процесса
+    /// </summary>
+    void onStopSignal(int sig)
     {
-        chat_manager_t chat(u32_port);
-        chat.Work();
+        std::signal(sig, SIG_DFL);
+        if (chat_manager_t* chat = g_chat.load())
+            chat->Stop();
     }
-    else
-        printf("Invalid parametr's. Please enter the number_port\n");
-
-    return EXIT_SUCCESS;
 }
 
-/// <summary>
-/// функция разобра параметров командной строки
-/// </summary>
-/// <param name="argc"> - количество параметров </param>
-/// <param name="argv"> - массив параметров </param>
-/// <param name="r_port"> - ссылка на порт для прослушки </param>
-/// <returns> 1 - праметры распознаны </returns>
-bool parseParam(int argc, char* argv[], unsigned& r_port)
+int main(int argc, char* argv[])
 {
-    bool b_result = false;
+    config_t config;
 
-    if (argc == 2)
+    if (config.ParseArgs(argc, argv))
     {
-        r_port = std::strtoul(argv[1], NULL, 10);
-        b_result = r_port != 0 && r_port != 0xFFFFFFFFUL;
+        chat_manager_t chat(config);
+        g_chat = &chat;
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+        chat.Work();
+        g_chat = nullptr; // дальше - плавная остановка в деструкторе
     }
+    else
+        printf("Invalid parametr's: %s\n"
+            "Please enter the number_port [number_admin_port [trace_1_of_N_messages]] [--key value ...]\n"
+            "keys: --config file, --listen, --port, --admin-listen, --admin-port, --trace-sample, --max-clients,\n"
+            "      --pool-threads, --recv-chunk, --max-frame, --session-arena, --backlog, --accept-batch,\n"
+            "      --socket-profile low_latency|low_latency_busy_poll|bulk|federation,\n"
+            "      --conn-rate, --conn-burst, --conn-rate-ip, --conn-burst-ip, --conn-max-ip, --admission-table,\n"
+            "      --msg-rate, --msg-burst, --byte-rate, --byte-burst, --ping-interval-ms, --idle-timeout-ms, --write-stall-ms,\n"
+            "      --drain-timeout-ms, --handoff-path, --takeover,\n"
+            "      --history-dir, --history-fsync none|interval|every, --history-fsync-ms, --history-fsync-every, --history-segment-mb,\n"
+            "      --history-replay\n",
+            config.error.c_str());
 
-    return b_result;
+    return EXIT_SUCCESS;
 }
-